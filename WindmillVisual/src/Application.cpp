@@ -3,35 +3,83 @@
 
 const float Application::kZoomSpeed = 0.1f;
 
+const char* Application::kTracePath = "trace.json";
+
+// what most displays refresh at, for when the system can't tell
+const double Application::kDefaultFrameRate = 60.0;
+
+// vsync paces the frames; the scheduler caps them this far above the
+// display's rate, so it only steps in when vsync is off and never holds a
+// frame past a refresh
+const double Application::kFrameRateMargin = 1.25;
+
+// points per second
+const float Application::kBrushRate = 5000.0f;
+
+// in pixels, so the brush looks the same at any zoom
+const float Application::kBrushRadius = 40.0f;
+
+// in pixels between the points of a lasso
+const float Application::kLassoSpacing = 4.0f;
+
+const double Application::kRotateStep = M_PI / 12.0;
+
+const double Application::kScaleStep = 1.1;
+
 
 Application::Application(sf::VideoMode video_mode, const char* title)
 	: render_window_(video_mode, title)
 	, world_view_()
 	, starting_height_(video_mode.height)
 	, mouse_dragging_(false)
+  , scrubbing_(false)
+  , scrub_revolutions_(10.0)
+  , brush_mode_(false)
+  , spraying_(false)
+  , spray_carry_(0.0f)
+  , selecting_(Selecting::kNone)
+  , moving_selection_(false)
+  , move_offset_(0.0f, 0.0f)
 	, windmill_(click_sound_buffer_)
   , gui_("LClick+Drag  - Move View\n"
          "Shift+LClick - Create Point\n"
          "Shift+RClick - Delete Point\n"
          "RClick       - Select Pivot\n"
+         "Ctrl+LDrag   - Select Rectangle\n"
+         "Alt+LDrag    - Select Lasso\n"
+         "Ctrl+RDrag   - Move Selection\n"
+         "Q/W          - Rotate Selection\n"
+         "Z/X          - Shrink/Grow Selection\n"
+         "Delete       - Delete Selection\n"
+         "Esc          - Clear Selection\n"
          "\n"
          "Enter        - Start Windmill\n"
          "Space        - Play/Pause Windmill\n"
          "R            - Restart Windmill\n"
          "L/R Arrows   - Change Speed\n"
+         "LClick Bar   - Seek\n"
+         "U/D Arrows   - Change Seek Range\n"
+         "B            - Spray Brush On/Off\n"
          "A            - Show/Hide Arrows\n"
+         "F            - Show/Hide Frame Stats\n"
+         "P            - Record/Save Trace\n"
+         "E            - Switch Engine\n"
+         "C            - Complete Path\n"
+         "T            - Precompute Transitions\n"
          "V            - Reset View/Zoom\n",
-         22u)
+         20u)
   , msg_shown_(false)
-	, clock_()
+  , stats_shown_(false)
+  , scheduler_(getFrameCap())
 	, dt_(0.f)
+  , dirty_(true)
 {
+  render_window_.setVerticalSyncEnabled(true);
+
 	UpdateViews();
 
   if (!click_sound_buffer_.loadFromFile("res/click.wav"))
     throw std::runtime_error("Error loading file");
-
-	render_window_.setFramerateLimit(300u);
 }
 
 
@@ -40,15 +88,43 @@ void Application::Run()
 
 	while (render_window_.isOpen())
 	{
-		dt_ = clock_.getElapsedTime().asSeconds();
-		clock_.restart();
+    // waiting out an idle scene is no part of a frame
+    WaitForEvents();
+
+    TRACE_SCOPE("Application::Frame");
+
+		dt_ = scheduler_.BeginFrame();
+
+    phase_clock_.restart();
 
 		PollEvents();
+    float poll_time = phase_clock_.restart().asSeconds();
 
 		Update();
+    float update_time = phase_clock_.restart().asSeconds();
+
+    // a still scene stays on screen as it was last drawn
+    if (dirty_ || windmill_.isAnimating())
+    {
+      dirty_ = false;
+
+		  Render();
+      float render_time = phase_clock_.restart().asSeconds();
+
+      {
+        TRACE_SCOPE("Application::Display");
+        render_window_.display();
+      }
+
+      frame_stats_.AddFrame(poll_time, update_time, render_time);
+    }
 
-		Render();
+    scheduler_.WaitForNextFrame();
 	}
+
+  // a recording still running when the window closes is saved too
+  if (Trace::isEnabled())
+    Trace::WriteJson(kTracePath);
 }
 
 
@@ -66,155 +142,455 @@ inline void Application::UpdateViews()
 }
 
 
+void Application::Scrub(sf::Vector2i mouse_position)
+{
+  float fraction = gui_.getTimelineFraction(render_window_.mapPixelToCoords(mouse_position, gui_view_), gui_view_);
+
+  windmill_.SeekTo(fraction * scrub_revolutions_ * 2 * M_PI);
+}
+
+
+void Application::Spray()
+{
+  if (!spraying_)
+    return;
+
+  // the release may have happened outside the window
+  if (!sf::Mouse::isButtonPressed(sf::Mouse::Button::Left))
+  {
+    spraying_ = false;
+    return;
+  }
+
+  // the fraction of a point left over is sprayed with the next frame
+  spray_carry_ += kBrushRate * dt_;
+  size_t count = (size_t)spray_carry_;
+  spray_carry_ -= (float)count;
+
+  if (count == 0)
+    return;
+
+  sf::Vector2f center = render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_);
+  float radius = kBrushRadius * world_view_.getSize().y / (float)render_window_.getSize().y;
+
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  // uniform over the disc
+  spray_.resize(count);
+  for (auto& position : spray_)
+  {
+    float r = radius * std::sqrt(unit(rng_));
+    float a = 2.0f * (float)M_PI * unit(rng_);
+    position = center + sf::Vector2f(r * std::cos(a), r * std::sin(a));
+  }
+
+  windmill_.AddPoints(spray_.data(), spray_.size());
+  dirty_ = true;
+}
+
+
+void Application::MoveSelection()
+{
+  if (!moving_selection_)
+    return;
+
+  if (!sf::Mouse::isButtonPressed(sf::Mouse::Button::Right))
+    moving_selection_ = false;
+
+  if (move_offset_ == sf::Vector2f(0.0f, 0.0f))
+    return;
+
+  windmill_.TranslateSelection(move_offset_);
+  move_offset_ = sf::Vector2f(0.0f, 0.0f);
+  dirty_ = true;
+}
+
+
+void Application::FinishSelecting()
+{
+  if (selecting_ == Selecting::kRect)
+  {
+    sf::Vector2f end = render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_);
+    sf::Vector2f min(std::min(select_start_.x, end.x), std::min(select_start_.y, end.y));
+    sf::Vector2f max(std::max(select_start_.x, end.x), std::max(select_start_.y, end.y));
+
+    windmill_.SelectRect(sf::FloatRect(min, max - min));
+  }
+  else if (selecting_ == Selecting::kLasso)
+  {
+    windmill_.SelectLasso(lasso_);
+  }
+
+  selecting_ = Selecting::kNone;
+  lasso_.clear();
+}
+
+
+void Application::DrawSelecting()
+{
+  if (selecting_ == Selecting::kNone)
+    return;
+
+  sf::Color color(120, 200, 255);
+  sf::VertexArray outline(sf::LineStrip);
+
+  if (selecting_ == Selecting::kRect)
+  {
+    sf::Vector2f end = render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_);
+
+    outline.append(sf::Vertex(select_start_, color));
+    outline.append(sf::Vertex({ end.x, select_start_.y }, color));
+    outline.append(sf::Vertex(end, color));
+    outline.append(sf::Vertex({ select_start_.x, end.y }, color));
+    outline.append(sf::Vertex(select_start_, color));
+  }
+  else
+  {
+    for (const sf::Vector2f& point : lasso_)
+      outline.append(sf::Vertex(point, color));
+    if (!lasso_.empty())
+      outline.append(sf::Vertex(lasso_.front(), color));
+  }
+
+  render_window_.draw(outline);
+}
+
+
+void Application::WaitForEvents()
+{
+  if (dirty_ || spraying_ || moving_selection_ || windmill_.isAnimating())
+    return;
+
+  sf::Event e;
+  if (render_window_.waitEvent(e))
+    HandleEvent(e);
+
+  // the time spent waiting isn't a frame
+  scheduler_.Reset();
+}
+
+
+double Application::getFrameCap()
+{
+  double rate = FrameScheduler::getDisplayRate();
+  if (rate <= 0.0)
+    rate = kDefaultFrameRate;
+
+  return rate * kFrameRateMargin;
+}
+
+
 void Application::PollEvents()
 {
+  TRACE_SCOPE("Application::PollEvents");
+
 	sf::Event e;
 	while (render_window_.pollEvent(e))
+    HandleEvent(e);
+}
+
+
+void Application::HandleEvent(const sf::Event& e)
+{
+  // any input may change what's on screen
+  dirty_ = true;
+
+	if (e.type == sf::Event::Closed)
 	{
-		if (e.type == sf::Event::Closed)
-		{
-			render_window_.close();
-		}
-		else if (e.type == sf::Event::Resized)
-		{
-      if (e.size.width < 600 || e.size.height < 600)
-      {
-        render_window_.setSize({ 600u, 600u });
-      }
-      else
-      {
-			  UpdateViews();
-      }
-		}
-		else if (e.type == sf::Event::MouseWheelScrolled)
-		{
-			float zoom_amount = kZoomSpeed * e.mouseWheelScroll.delta;
+		render_window_.close();
+	}
+	else if (e.type == sf::Event::Resized)
+	{
+    if (e.size.width < 600 || e.size.height < 600)
+    {
+      render_window_.setSize({ 600u, 600u });
+    }
+    else
+    {
+		  UpdateViews();
+    }
+	}
+	else if (e.type == sf::Event::MouseWheelScrolled)
+	{
+		float zoom_amount = kZoomSpeed * e.mouseWheelScroll.delta;
 
-      if (world_view_.getSize().y < 0.05 && zoom_amount > 0 ||
-          world_view_.getSize().y > 50000 && zoom_amount < 0)
-        continue;
+    if (world_view_.getSize().y < 0.05 && zoom_amount > 0 ||
+        world_view_.getSize().y > 50000 && zoom_amount < 0)
+      return;
 
-      // Moves view so view zooms "into" mouse position
-			sf::Vector2f view_center = world_view_.getCenter();
-			sf::Vector2f mouse_position = render_window_.mapPixelToCoords(
-        sf::Mouse::getPosition(render_window_), world_view_);
+    // Moves view so view zooms "into" mouse position
+		sf::Vector2f view_center = world_view_.getCenter();
+		sf::Vector2f mouse_position = render_window_.mapPixelToCoords(
+      sf::Mouse::getPosition(render_window_), world_view_);
 
-			world_view_.move(
-          zoom_amount * (mouse_position.x - view_center.x),
-				  zoom_amount * (mouse_position.y - view_center.y));
+		world_view_.move(
+        zoom_amount * (mouse_position.x - view_center.x),
+			  zoom_amount * (mouse_position.y - view_center.y));
 
-			world_view_.zoom(1.0f - zoom_amount);
-		}
-		else if (e.type == sf::Event::MouseButtonPressed)
+		world_view_.zoom(1.0f - zoom_amount);
+	}
+	else if (e.type == sf::Event::MouseButtonPressed)
+	{
+		if (e.mouseButton.button == sf::Mouse::Button::Left)
 		{
-			if (e.mouseButton.button == sf::Mouse::Button::Left)
+			if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift))
 			{
-				if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift))
-				{
-					windmill_.AddPoint(render_window_.mapPixelToCoords(sf::Vector2i(e.mouseButton.x, e.mouseButton.y), world_view_));
-				}
-				else
-				{
-					mouse_dragging_ = true;
-					last_click_position_ = render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_);
-				}
+				windmill_.AddPoint(render_window_.mapPixelToCoords(sf::Vector2i(e.mouseButton.x, e.mouseButton.y), world_view_));
 			}
-			else if (e.mouseButton.button == sf::Mouse::Button::Right)
+      else if (sf::Keyboard::isKeyPressed(sf::Keyboard::LControl))
+      {
+        selecting_ = Selecting::kRect;
+        select_start_ = render_window_.mapPixelToCoords({ e.mouseButton.x, e.mouseButton.y }, world_view_);
+      }
+      else if (sf::Keyboard::isKeyPressed(sf::Keyboard::LAlt))
+      {
+        selecting_ = Selecting::kLasso;
+        lasso_.assign(1, render_window_.mapPixelToCoords({ e.mouseButton.x, e.mouseButton.y }, world_view_));
+      }
+      else if (windmill_.isStarted() && 
+               gui_.isOnTimeline(render_window_.mapPixelToCoords({ e.mouseButton.x, e.mouseButton.y }, gui_view_), gui_view_))
+      {
+        scrubbing_ = true;
+        Scrub({ e.mouseButton.x, e.mouseButton.y });
+      }
+      else if (brush_mode_)
+      {
+        spraying_ = true;
+        spray_carry_ = 0.0f;
+      }
+			else
 			{
-				if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift))
-				{
-					windmill_.TryDelete(render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_));
-				}
-				else
-				{
-					windmill_.ChoosePivot(render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_));
-				}
+				mouse_dragging_ = true;
+				last_click_position_ = render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_);
 			}
 		}
-		else if (e.type == sf::Event::MouseButtonReleased)
+		else if (e.mouseButton.button == sf::Mouse::Button::Right)
 		{
-			if (e.mouseButton.button == sf::Mouse::Button::Left)
+			if (sf::Keyboard::isKeyPressed(sf::Keyboard::LShift))
 			{
-				mouse_dragging_ = false;
+				windmill_.TryDelete(render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_));
 			}
-		}
-		else if (e.type == sf::Event::MouseMoved)
-		{
-			if (mouse_dragging_)
+      else if (sf::Keyboard::isKeyPressed(sf::Keyboard::LControl) && windmill_.hasSelection())
+      {
+        moving_selection_ = true;
+        move_from_ = render_window_.mapPixelToCoords({ e.mouseButton.x, e.mouseButton.y }, world_view_);
+      }
+			else
 			{
-				world_view_.setCenter(world_view_.getCenter() - 
-				(render_window_.mapPixelToCoords({ e.mouseMove.x, e.mouseMove.y}, world_view_) - last_click_position_));
+				windmill_.ChoosePivot(render_window_.mapPixelToCoords(sf::Mouse::getPosition(render_window_), world_view_));
 			}
-      else
-      {
-        auto mp = render_window_.mapPixelToCoords(
-            sf::Mouse::getPosition(render_window_), 
-            gui_view_);
+		}
+	}
+	else if (e.type == sf::Event::MouseButtonReleased)
+	{
+		if (e.mouseButton.button == sf::Mouse::Button::Left)
+		{
+			mouse_dragging_ = false;
+      scrubbing_ = false;
+      spraying_ = false;
+      FinishSelecting();
+		}
+		else if (e.mouseButton.button == sf::Mouse::Button::Right)
+		{
+      moving_selection_ = false;
+		}
+	}
+	else if (e.type == sf::Event::MouseMoved)
+	{
+    if (scrubbing_)
+    {
+      Scrub({ e.mouseMove.x, e.mouseMove.y });
+    }
+    else if (selecting_ == Selecting::kLasso)
+    {
+      // a point every few pixels keeps the outline short
+      sf::Vector2f point = render_window_.mapPixelToCoords({ e.mouseMove.x, e.mouseMove.y }, world_view_);
+      sf::Vector2f step = point - lasso_.back();
+      float spacing = kLassoSpacing * world_view_.getSize().y / (float)render_window_.getSize().y;
+
+      if (step.x * step.x + step.y * step.y >= spacing * spacing)
+        lasso_.push_back(point);
+    }
+    else if (moving_selection_)
+    {
+      sf::Vector2f point = render_window_.mapPixelToCoords({ e.mouseMove.x, e.mouseMove.y }, world_view_);
+      move_offset_ += point - move_from_;
+      move_from_ = point;
+    }
+		else if (mouse_dragging_)
+		{
+			world_view_.setCenter(world_view_.getCenter() - 
+			(render_window_.mapPixelToCoords({ e.mouseMove.x, e.mouseMove.y}, world_view_) - last_click_position_));
+		}
+    else
+    {
+      auto mp = render_window_.mapPixelToCoords(
+          sf::Mouse::getPosition(render_window_), 
+          gui_view_);
 
-        msg_shown_ = mp.x < 50 && mp.x >= 0 && mp.y < 50 && mp.y >= 0;
-      }
+      msg_shown_ = mp.x < 50 && mp.x >= 0 && mp.y < 50 && mp.y >= 0;
+
+      windmill_.Hover(render_window_.mapPixelToCoords({ e.mouseMove.x, e.mouseMove.y }, world_view_));
+    }
+	}
+	else if (e.type == sf::Event::MouseLeft)
+	{
+    windmill_.ClearHover();
+	}
+	else if (e.type == sf::Event::KeyPressed)
+	{
+		if (e.key.code == sf::Keyboard::Enter)
+		{
+			windmill_.Start();
 		}
-		else if (e.type == sf::Event::KeyPressed)
+		else if (e.key.code == sf::Keyboard::Space)
 		{
-			if (e.key.code == sf::Keyboard::Enter)
-			{
-				windmill_.Start();
-			}
-			else if (e.key.code == sf::Keyboard::Space)
-			{
-				windmill_.TogglePause();
-			}
-			else if (e.key.code == sf::Keyboard::R)
-			{
-				windmill_.Restart();
-			}
-			else if (e.key.code == sf::Keyboard::V)
-			{
-				if (windmill_.isPivotSet())
-					world_view_.setCenter(windmill_.getPivotPosition());
+			windmill_.TogglePause();
+		}
+		else if (e.key.code == sf::Keyboard::R)
+		{
+			windmill_.Restart();
+		}
+		else if (e.key.code == sf::Keyboard::V)
+		{
+			if (windmill_.isPivotSet())
+				world_view_.setCenter(windmill_.getPivotPosition());
 
 
-        float new_width = (float)starting_height_ * (float)render_window_.getSize().x / render_window_.getSize().y;
+      float new_width = (float)starting_height_ * (float)render_window_.getSize().x / render_window_.getSize().y;
 
-        world_view_.setSize(sf::Vector2f(new_width, (float)starting_height_));
-			}
-			else if (e.key.code == sf::Keyboard::Left)
-			{
-				windmill_.MultiplyAngularSpeed(0.9);
-			}
-			else if (e.key.code == sf::Keyboard::Right)
-			{
-				windmill_.MultiplyAngularSpeed(1.1);
-			}
-      else if (e.key.code == sf::Keyboard::A)
+      world_view_.setSize(sf::Vector2f(new_width, (float)starting_height_));
+		}
+		else if (e.key.code == sf::Keyboard::Left)
+		{
+			windmill_.MultiplyAngularSpeed(0.9);
+		}
+		else if (e.key.code == sf::Keyboard::Right)
+		{
+			windmill_.MultiplyAngularSpeed(1.1);
+		}
+    else if (e.key.code == sf::Keyboard::Up)
+    {
+      scrub_revolutions_ = std::min(scrub_revolutions_ * 10.0, 1e6);
+    }
+    else if (e.key.code == sf::Keyboard::Down)
+    {
+      scrub_revolutions_ = std::max(scrub_revolutions_ / 10.0, 1.0);
+    }
+    else if (e.key.code == sf::Keyboard::B)
+    {
+      brush_mode_ = !brush_mode_;
+      spraying_ = false;
+    }
+    else if (e.key.code == sf::Keyboard::A)
+    {
+      windmill_.toggleArrows();
+    }
+    else if (e.key.code == sf::Keyboard::F)
+    {
+      stats_shown_ = !stats_shown_;
+    }
+    else if (e.key.code == sf::Keyboard::P)
+    {
+      // first press starts recording, the next saves it
+      if (Trace::isEnabled())
       {
-        windmill_.toggleArrows();
+        Trace::WriteJson(kTracePath);
+        Trace::setEnabled(false);
       }
-		}
+      else
+      {
+        Trace::setEnabled(true);
+      }
+    }
+    else if (e.key.code == sf::Keyboard::E)
+    {
+      windmill_.toggleEngine();
+    }
+    else if (e.key.code == sf::Keyboard::C)
+    {
+      windmill_.CompletePath();
+    }
+    else if (e.key.code == sf::Keyboard::T)
+    {
+      windmill_.PrecomputeTransitions();
+    }
+    else if (e.key.code == sf::Keyboard::Q)
+    {
+      windmill_.RotateSelection(-kRotateStep);
+    }
+    else if (e.key.code == sf::Keyboard::W)
+    {
+      windmill_.RotateSelection(kRotateStep);
+    }
+    else if (e.key.code == sf::Keyboard::Z)
+    {
+      windmill_.ScaleSelection(1.0 / kScaleStep);
+    }
+    else if (e.key.code == sf::Keyboard::X)
+    {
+      windmill_.ScaleSelection(kScaleStep);
+    }
+    else if (e.key.code == sf::Keyboard::Delete)
+    {
+      windmill_.DeleteSelection();
+    }
+    else if (e.key.code == sf::Keyboard::Escape)
+    {
+      selecting_ = Selecting::kNone;
+      lasso_.clear();
+      windmill_.ClearSelection();
+    }
 	}
 }
 
 
 inline void Application::Update()
 {
+  TRACE_SCOPE("Application::Update");
+
+  Spray();
+  MoveSelection();
+
 	windmill_.Update(dt_, world_view_.getSize().x * 20.0f);
+
+  frame_stats_.AddSwitches(windmill_.getFrameSwitches(), dt_);
 }
 
 
 void Application::Render()
 {
+  TRACE_SCOPE("Application::Render");
+
 	render_window_.clear(sf::Color::Black);
 
   // World's View
 	render_window_.setView(world_view_);
 	windmill_.Draw(render_window_, world_view_);
+  DrawSelecting();
 
   // Gui's View
   render_window_.setView(gui_view_);
 
   gui_.Draw(render_window_, gui_view_, msg_shown_);
 
-  windmill_.DrawPausedSymbol(render_window_, gui_view_);
+  if (stats_shown_)
+  {
+    const DrawStats& draw_stats = windmill_.getDrawStats();
+    frame_stats_.setDrawCounts(draw_stats.draw_calls, draw_stats.points_drawn, draw_stats.arrows_drawn);
+
+    gui_.DrawFrameStats(render_window_, frame_stats_.getSummary(), msg_shown_);
+  }
 
-	render_window_.display();
+  if (windmill_.isStarted())
+  {
+    double revolutions = windmill_.getTotalAngle() / (2 * M_PI);
+
+    char label[64];
+    snprintf(label, sizeof(label), "%.1f / %.0f rev", revolutions, scrub_revolutions_);
+
+    gui_.DrawTimeline(render_window_, gui_view_, (float)std::min(revolutions / scrub_revolutions_, 1.0), label);
+  }
+
+  windmill_.DrawPausedSymbol(render_window_, gui_view_);
 }
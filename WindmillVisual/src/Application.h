@@ -2,18 +2,33 @@
 
 #include <stdexcept>
 #include <string>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <stdio.h>
 
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
 
 #include "Sim/Windmill.h"
 #include "GUI.h"
+#include "FrameStats.h"
+#include "FrameScheduler.h"
+#include "Sim/Trace.h"
 
 class Application
 {
 private:
 
 	static const float kZoomSpeed;
+  static const char* kTracePath;
+  static const double kDefaultFrameRate;
+  static const double kFrameRateMargin;
+  static const float kBrushRate;
+  static const float kBrushRadius;
+  static const float kLassoSpacing;
+  static const double kRotateStep;
+  static const double kScaleStep;
 
 	sf::RenderWindow render_window_;
 	sf::View world_view_;
@@ -24,6 +39,33 @@ private:
 	sf::Vector2f last_click_position_;
 	bool mouse_dragging_;
 
+  bool scrubbing_;
+  double scrub_revolutions_;
+
+  // with the brush on, dragging sprays points instead of moving the view
+  bool brush_mode_;
+  bool spraying_;
+  float spray_carry_;
+  std::vector<sf::Vector2f> spray_;
+  std::mt19937 rng_;
+
+  // Ctrl drags a selection rectangle, Alt a lasso, both in world coordinates
+  enum class Selecting
+  {
+    kNone,
+    kRect,
+    kLasso
+  };
+
+  Selecting selecting_;
+  sf::Vector2f select_start_;
+  std::vector<sf::Vector2f> lasso_;
+
+  // Ctrl+RDrag moves the selection by what the mouse moved since the last frame
+  bool moving_selection_;
+  sf::Vector2f move_from_;
+  sf::Vector2f move_offset_;
+
 	sf::SoundBuffer click_sound_buffer_;
 
 	Windmill windmill_;
@@ -32,11 +74,39 @@ private:
 
   bool msg_shown_;
 
-	sf::Clock clock_;
+  FrameStats frame_stats_;
+  bool stats_shown_;
+
+  FrameScheduler scheduler_;
 	float dt_;
 
+  // something changed since the last frame was drawn
+  bool dirty_;
+
+  sf::Clock phase_clock_;
+
   void UpdateViews();
 
+  void Scrub(sf::Vector2i mouse_position);
+
+  // Deposits the points the brush sprayed during the frame
+  void Spray();
+
+  // Applies the moves of the selection since the last frame, as one
+  void MoveSelection();
+
+  void FinishSelecting();
+
+  void DrawSelecting();
+
+  void HandleEvent(const sf::Event& e);
+
+  // Blocks until an event arrives, when nothing on screen is moving
+  void WaitForEvents();
+
+  // Frames per second the scheduler holds the loop to
+  static double getFrameCap();
+
   void PollEvents();
   inline void Update();
   void Render();
@@ -0,0 +1,120 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+
+const double FrameScheduler::min_spin_seconds_ = 0.0005;
+
+// a wait this long is cheaper than a missed frame, a longer one isn't
+const double FrameScheduler::max_spin_seconds_ = 0.001;
+
+// within the spin window the thread still naps in steps this short, and only
+// yields through the last couple of them
+const double FrameScheduler::nap_seconds_ = 0.0001;
+
+const float FrameScheduler::smoothing_ = 0.1f;
+
+const float FrameScheduler::max_dt_ = 0.1f;
+
+
+FrameScheduler::FrameScheduler(double frame_rate)
+  : period_(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frame_rate)))
+  , oversleep_(std::chrono::milliseconds(1))
+  , dt_(0.0f)
+{
+#if defined(_WIN32)
+  // the default timer only wakes a sleep every 15.6 ms
+  timeBeginPeriod(1);
+#endif
+
+  Reset();
+}
+
+
+FrameScheduler::~FrameScheduler()
+{
+#if defined(_WIN32)
+  timeEndPeriod(1);
+#endif
+}
+
+
+void FrameScheduler::Reset()
+{
+  last_frame_ = next_frame_ = Clock::now();
+  dt_ = getPeriod();
+}
+
+
+float FrameScheduler::BeginFrame()
+{
+  Clock::time_point now = Clock::now();
+  float raw = std::min(std::chrono::duration<float>(now - last_frame_).count(), max_dt_);
+  last_frame_ = now;
+
+  dt_ += smoothing_ * (raw - dt_);
+  return dt_;
+}
+
+
+void FrameScheduler::WaitForNextFrame()
+{
+  next_frame_ += period_;
+
+  Clock::time_point now = Clock::now();
+
+  // too far behind to catch up, start counting from here
+  if (now > next_frame_ + period_)
+  {
+    next_frame_ = now;
+    return;
+  }
+
+  auto spin = std::min(oversleep_ + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(min_spin_seconds_)),
+                       std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(max_spin_seconds_)));
+  if (next_frame_ - now > spin)
+  {
+    Clock::time_point wake = next_frame_ - spin;
+    std::this_thread::sleep_until(wake);
+
+    oversleep_ = std::max(oversleep_ - oversleep_ / 64, Clock::now() - wake);
+  }
+
+  auto nap = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(nap_seconds_));
+  for (now = Clock::now(); now < next_frame_; now = Clock::now())
+  {
+    if (next_frame_ - now > 2 * nap)
+      std::this_thread::sleep_for(nap);
+    else
+      std::this_thread::yield();
+  }
+}
+
+
+float FrameScheduler::getPeriod() const
+{
+  return std::chrono::duration<float>(period_).count();
+}
+
+
+double FrameScheduler::getDisplayRate()
+{
+#if defined(_WIN32)
+  DEVMODE mode;
+  ZeroMemory(&mode, sizeof(mode));
+  mode.dmSize = sizeof(mode);
+
+  // 0 and 1 stand for the hardware's default, whatever that is
+  if (EnumDisplaySettings(NULL, ENUM_CURRENT_SETTINGS, &mode) && mode.dmDisplayFrequency > 1)
+    return (double)mode.dmDisplayFrequency;
+#endif
+
+  return 0.0;
+}
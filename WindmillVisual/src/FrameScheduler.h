@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+
+// Paces frames to a fixed rate against a steady clock. The wait sleeps for
+// most of the gap, leaving out as much as sleeps have lately been
+// overshooting by, and gets through the end of it in short naps, yielding
+// only for the last moment.
+// The frame time handed to the simulation is smoothed, so one late frame
+// doesn't make the windmill lurch.
+class FrameScheduler
+{
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  static const double min_spin_seconds_;
+  static const double max_spin_seconds_;
+  static const double nap_seconds_;
+  static const float smoothing_;
+  static const float max_dt_;
+
+  Clock::duration period_;
+  Clock::time_point next_frame_;
+  Clock::time_point last_frame_;
+
+  // worst recent overshoot of a sleep, decaying slowly
+  Clock::duration oversleep_;
+
+  float dt_;
+
+public:
+
+  explicit FrameScheduler(double frame_rate);
+  ~FrameScheduler();
+
+  // Starts timing afresh, so time spent idle doesn't count as a frame
+  void Reset();
+
+  // Returns the smoothed seconds since the last frame began
+  float BeginFrame();
+
+  // Blocks until the next frame is due
+  void WaitForNextFrame();
+
+  float getPeriod() const;
+
+  // The main display's refresh rate, or 0 when the system can't tell
+  static double getDisplayRate();
+
+};
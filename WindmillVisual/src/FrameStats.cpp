@@ -0,0 +1,99 @@
+#include "FrameStats.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+
+const size_t FrameStats::sample_count_ = 256u;
+
+const float FrameStats::switch_window_ = 1.0f;
+
+
+FrameStats::FrameStats()
+  : next_sample_(0)
+  , filled_(0)
+  , draw_calls_(0)
+  , points_drawn_(0)
+  , arrows_drawn_(0)
+  , window_switches_(0)
+  , window_time_(0.0f)
+  , switches_per_second_(0.0f)
+{
+  for (auto& samples : samples_)
+    samples.resize(sample_count_, 0.0f);
+}
+
+
+void FrameStats::AddFrame(float poll_events, float update, float render)
+{
+  samples_[kPollEvents][next_sample_] = poll_events;
+  samples_[kUpdate][next_sample_] = update;
+  samples_[kRender][next_sample_] = render;
+
+  next_sample_ = (next_sample_ + 1) % sample_count_;
+  filled_ = std::min(filled_ + 1, sample_count_);
+}
+
+
+void FrameStats::AddSwitches(size_t count, float dt)
+{
+  window_switches_ += count;
+  window_time_ += dt;
+
+  if (window_time_ >= switch_window_)
+  {
+    switches_per_second_ = window_switches_ / window_time_;
+    window_switches_ = 0;
+    window_time_ = 0.0f;
+  }
+}
+
+
+void FrameStats::setDrawCounts(unsigned draw_calls, size_t points_drawn, size_t arrows_drawn)
+{
+  draw_calls_ = draw_calls;
+  points_drawn_ = points_drawn;
+  arrows_drawn_ = arrows_drawn;
+}
+
+
+float FrameStats::getPercentile(Phase phase, float p)
+{
+  if (filled_ == 0)
+    return 0.0f;
+
+  sorted_.assign(samples_[phase].begin(), samples_[phase].begin() + filled_);
+
+  size_t rank = std::min((size_t)(p * filled_), filled_ - 1);
+  std::nth_element(sorted_.begin(), sorted_.begin() + rank, sorted_.end());
+
+  return sorted_[rank];
+}
+
+
+std::string FrameStats::getSummary()
+{
+  static const char* phase_names[kPhaseCount] = { "Events", "Update", "Render" };
+
+  char line[128];
+  std::string summary = "ms          p50     p95     p99\n";
+
+  for (int phase = 0; phase < kPhaseCount; phase++)
+  {
+    snprintf(line, sizeof(line), "%-8s %6.2f  %6.2f  %6.2f\n", phase_names[phase],
+             1000.0f * getPercentile((Phase)phase, 0.50f),
+             1000.0f * getPercentile((Phase)phase, 0.95f),
+             1000.0f * getPercentile((Phase)phase, 0.99f));
+    summary += line;
+  }
+
+  snprintf(line, sizeof(line),
+           "\nDraw Calls  %10u\n"
+           "Points      %10zu\n"
+           "Arrows      %10zu\n"
+           "Switches/s  %10.1f",
+           draw_calls_, points_drawn_, arrows_drawn_, switches_per_second_);
+  summary += line;
+
+  return summary;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+// Rolling timings of the phases of a frame, along with what the frame drew
+// and how fast the windmill is switching.
+class FrameStats
+{
+public:
+
+  enum Phase
+  {
+    kPollEvents,
+    kUpdate,
+    kRender,
+    kPhaseCount
+  };
+
+private:
+
+  static const size_t sample_count_;
+  static const float switch_window_;
+
+  std::array<std::vector<float>, kPhaseCount> samples_;
+  size_t next_sample_;
+  size_t filled_;
+
+  std::vector<float> sorted_;
+
+  unsigned draw_calls_;
+  size_t points_drawn_;
+  size_t arrows_drawn_;
+
+  // switches and time since the window started, and the rate of the last window
+  size_t window_switches_;
+  float window_time_;
+  float switches_per_second_;
+
+public:
+
+  FrameStats();
+
+  // Records the seconds each phase took, once per frame
+  void AddFrame(float poll_events, float update, float render);
+
+  void AddSwitches(size_t count, float dt);
+
+  void setDrawCounts(unsigned draw_calls, size_t points_drawn, size_t arrows_drawn);
+
+  // Seconds below which fraction p of the recorded frames took
+  float getPercentile(Phase phase, float p);
+
+  std::string getSummary();
+
+};
@@ -1,11 +1,18 @@
 #include "GUI.h"
 
+#include <algorithm>
+
 
 GUI::GUI(const char* text, unsigned text_size)
   : font_()
   , text_(text, font_, text_size)
   , background_({ 0.0f, 0.0f })
   , hoverbox_shape_(sf::Vector2f(35.0f, 35.0f))
+  , stats_text_("", font_, 16u)
+  , stats_background_({ 0.0f, 0.0f })
+  , timeline_shape_({ 0.0f, 8.0f })
+  , timeline_handle_({ 6.0f, 20.0f })
+  , timeline_text_("", font_, 16u)
 {
   sf::Vector2f padding = sf::Vector2f(20.0f, 20.0f);
 
@@ -27,6 +34,21 @@ GUI::GUI(const char* text, unsigned text_size)
   background_.setFillColor(sf::Color(255, 255, 255, 20));
   background_.setOutlineColor(sf::Color(150, 150, 150));
   background_.setOutlineThickness(1.0f);
+
+  stats_text_.setFillColor(sf::Color(220, 220, 220));
+
+  stats_background_.setFillColor(sf::Color(255, 255, 255, 20));
+  stats_background_.setOutlineColor(sf::Color(150, 150, 150));
+  stats_background_.setOutlineThickness(1.0f);
+
+  timeline_shape_.setFillColor(sf::Color(255, 255, 255, 20));
+  timeline_shape_.setOutlineColor(sf::Color(150, 150, 150));
+  timeline_shape_.setOutlineThickness(1.0f);
+
+  timeline_handle_.setOrigin(timeline_handle_.getSize() / 2.0f); // sets origin to center
+  timeline_handle_.setFillColor(sf::Color(220, 200, 200));
+
+  timeline_text_.setFillColor(sf::Color(220, 220, 220));
 }
 
 
@@ -53,3 +75,69 @@ void GUI::Draw(sf::RenderWindow& window, sf::View& gui_view, bool shown)
     window.draw(hoverbox_shape_);
   }
 }
+
+
+void GUI::DrawFrameStats(sf::RenderWindow& window, const std::string& stats, bool shown)
+{
+  sf::Vector2f padding(10.0f, 10.0f);
+
+  float left = (shown ? background_.getSize().x : hoverbox_shape_.getSize().x) + 10.0f;
+
+  stats_text_.setString(stats);
+  stats_text_.setPosition(left + padding.x, padding.y);
+
+  sf::FloatRect bounds = stats_text_.getLocalBounds();
+  stats_background_.setPosition(left, 0.0f);
+  stats_background_.setSize(2.f*padding + sf::Vector2f(bounds.left + bounds.width, bounds.top + bounds.height));
+
+  window.draw(stats_background_);
+  window.draw(stats_text_);
+}
+
+
+void GUI::UpdateTimelineShape(sf::View& gui_view)
+{
+  // spans the bottom of the screen, leaving room for the label on the right
+  timeline_shape_.setPosition(20.0f, gui_view.getSize().y - 30.0f);
+  timeline_shape_.setSize({ gui_view.getSize().x - 240.0f, timeline_shape_.getSize().y });
+}
+
+
+void GUI::DrawTimeline(sf::RenderWindow& window, sf::View& gui_view, float fraction, const std::string& label)
+{
+  UpdateTimelineShape(gui_view);
+
+  sf::Vector2f pos = timeline_shape_.getPosition();
+  sf::Vector2f size = timeline_shape_.getSize();
+
+  timeline_handle_.setPosition(pos.x + fraction * size.x, pos.y + size.y / 2.0f);
+
+  timeline_text_.setString(label);
+  timeline_text_.setPosition(pos.x + size.x + 20.0f, pos.y - 8.0f);
+
+  window.draw(timeline_shape_);
+  window.draw(timeline_handle_);
+  window.draw(timeline_text_);
+}
+
+
+bool GUI::isOnTimeline(sf::Vector2f pos, sf::View& gui_view)
+{
+  UpdateTimelineShape(gui_view);
+
+  sf::FloatRect bounds = timeline_shape_.getGlobalBounds();
+  bounds.top -= 10.0f;
+  bounds.height += 20.0f;
+
+  return bounds.contains(pos);
+}
+
+
+float GUI::getTimelineFraction(sf::Vector2f pos, sf::View& gui_view)
+{
+  UpdateTimelineShape(gui_view);
+
+  float fraction = (pos.x - timeline_shape_.getPosition().x) / timeline_shape_.getSize().x;
+
+  return std::min(std::max(fraction, 0.0f), 1.0f);
+}
\ No newline at end of file
@@ -15,6 +15,15 @@ public:
 
   void Draw(sf::RenderWindow& window, sf::View& gui_view, bool shown);
 
+  // Draws text in a box to the right of the hover box, or of the help when it is shown
+  void DrawFrameStats(sf::RenderWindow& window, const std::string& stats, bool shown);
+
+  void DrawTimeline(sf::RenderWindow& window, sf::View& gui_view, float fraction, const std::string& label);
+
+  bool isOnTimeline(sf::Vector2f pos, sf::View& gui_view);
+
+  float getTimelineFraction(sf::Vector2f pos, sf::View& gui_view);
+
 private:
 
   sf::Font font_;
@@ -24,5 +33,14 @@ private:
   sf::RectangleShape background_;
   sf::RectangleShape hoverbox_shape_;
 
+  sf::Text stats_text_;
+  sf::RectangleShape stats_background_;
+
+  sf::RectangleShape timeline_shape_;
+  sf::RectangleShape timeline_handle_;
+  sf::Text timeline_text_;
+
+  void UpdateTimelineShape(sf::View& gui_view);
+
 };
 
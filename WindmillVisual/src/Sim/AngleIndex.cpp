@@ -0,0 +1,321 @@
+#include "AngleIndex.h"
+
+#include <algorithm>
+#include <float.h>
+#include <string.h>
+
+#include "Trace.h"
+
+
+// pseudo-angles in float are off by a few 1e-7 at most, so any this close to
+// the lowest or to the line are compared again by their exact angles
+const float AngleIndex::scan_tolerance_ = 1e-5f;
+
+// enough for the pseudo-angle loop to vectorize, small enough to stay in cache
+const size_t AngleIndex::scan_block_ = 256;
+
+// a sort costs about as much as this many scans, so no pivot costs more
+// than twice what scanning or sorting alone would have
+const uint8_t AngleIndex::scans_per_sort_ = 64;
+
+
+AngleIndex::AngleIndex(size_t memory_budget)
+  : memory_budget_(memory_budget)
+  , memory_used_(0)
+{
+}
+
+
+const std::vector<AngleEntry>* AngleIndex::Find(PointId pivot_index)
+{
+  auto it = orders_.find(pivot_index);
+  if (it == orders_.end())
+    return nullptr;
+
+  lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+
+  return &it->second.entries;
+}
+
+
+const std::vector<AngleEntry>& AngleIndex::Insert(PointId pivot_index, std::vector<AngleEntry>&& entries)
+{
+  auto it = orders_.find(pivot_index);
+  if (it != orders_.end())
+  {
+    memory_used_ -= it->second.entries.capacity() * sizeof(AngleEntry);
+    lru_.erase(it->second.lru_it);
+    orders_.erase(it);
+  }
+
+  lru_.push_front(pivot_index);
+
+  Order& order = orders_[pivot_index];
+  order.entries = std::move(entries);
+  order.lru_it = lru_.begin();
+
+  memory_used_ += order.entries.capacity() * sizeof(AngleEntry);
+
+  Evict();
+
+  return order.entries;
+}
+
+
+bool AngleIndex::NextHit(const PointStore& points, size_t pivot_slot, double rad, double epsilon,
+                         unsigned& slot, double& delta)
+{
+  PointId pivot_index = points.id(pivot_slot);
+
+  if (auto entries = Find(pivot_index))
+    return NextHit(*entries, rad, epsilon, slot, delta);
+
+  // most pivots of a large set come up a few times a period or never again,
+  // so the sort only pays off for those that keep coming back
+  if (scans_.size() < points.size())
+    scans_.resize(points.size(), 0);
+
+  if (scans_[pivot_slot] < scans_per_sort_)
+  {
+    scans_[pivot_slot]++;
+    return ScanNextHit(points, pivot_slot, rad, epsilon, slot, delta);
+  }
+
+  std::vector<AngleEntry> entries;
+  BuildOrder(points, pivot_slot, entries);
+
+  return NextHit(Insert(pivot_index, std::move(entries)), rad, epsilon, slot, delta);
+}
+
+
+void AngleIndex::BuildOrder(const PointStore& points, size_t pivot_slot, std::vector<AngleEntry>& entries)
+{
+  double px = points.x(pivot_slot);
+  double py = points.y(pivot_slot);
+
+  entries.clear();
+  entries.reserve(points.size());
+
+  for (size_t i = 0; i < points.size(); i++)
+  {
+    // in double, so the angle back to the previous pivot lands within the
+    // switch epsilon of the line
+    double dx = points.x(i) - px;
+    double dy = points.y(i) - py;
+
+    if (i == pivot_slot || (dx == 0.0 && dy == 0.0))
+      continue;
+
+    entries.push_back({ ToHalfTurn(std::atan2(dy, dx)), (unsigned)i });
+  }
+
+  // ties go to the lower slot, as in ScanNextHit
+  std::sort(entries.begin(), entries.end(), 
+            [](const AngleEntry& a, const AngleEntry& b)
+            {
+              return a.angle < b.angle || (a.angle == b.angle && a.slot < b.slot);
+            });
+}
+
+
+void AngleIndex::Evict()
+{
+  // the most recently used order is always kept, even if it alone is over budget
+  while (memory_used_ > memory_budget_ && lru_.size() > 1)
+  {
+    auto it = orders_.find(lru_.back());
+
+    memory_used_ -= it->second.entries.capacity() * sizeof(AngleEntry);
+    orders_.erase(it);
+    lru_.pop_back();
+  }
+}
+
+
+void AngleIndex::Clear()
+{
+  orders_.clear();
+  lru_.clear();
+  scans_.clear();
+  memory_used_ = 0;
+}
+
+
+void AngleIndex::setMemoryBudget(size_t bytes)
+{
+  memory_budget_ = bytes;
+  Evict();
+}
+
+
+size_t AngleIndex::getMemoryUsed() const
+{
+  return memory_used_ + scans_.capacity();
+}
+
+
+double AngleIndex::getHitKey(double rad, double epsilon)
+{
+  double key = ToHalfTurn(rad) + epsilon;
+  return key >= M_PI ? key - M_PI : key;
+}
+
+
+double AngleIndex::ToHalfTurn(double angle)
+{
+  angle = std::fmod(angle, M_PI);
+  if (angle < 0)
+    angle += M_PI;
+  if (angle >= M_PI)
+    angle -= M_PI;
+
+  return angle;
+}
+
+
+bool AngleIndex::NextHit(const std::vector<AngleEntry>& entries, double rad, double epsilon,
+                         unsigned& slot, double& delta)
+{
+  size_t index;
+  if (!NextHitIndex(entries.size(), 
+                    [&entries](size_t i)
+                    {
+                      return entries[i].angle;
+                    },
+                    rad, epsilon, index, delta))
+    return false;
+
+  slot = entries[index].slot;
+  return true;
+}
+
+
+bool AngleIndex::ScanNextHit(const PointStore& points, size_t pivot_slot, double rad, double epsilon,
+                             unsigned& slot, double& delta)
+{
+  TRACE_SCOPE("AngleIndex::ScanNextHit");
+
+  double px = points.x(pivot_slot);
+  double py = points.y(pivot_slot);
+
+  double start = ToHalfTurn(rad);
+
+  // the same key NextHitIndex searches the sorted angles with
+  double key = start + epsilon;
+  int half_turns = 0;
+  if (key >= M_PI)
+  {
+    key -= M_PI;
+    half_turns++;
+  }
+
+  // Keeps the hit NextHitIndex would pick of the points offered: the fewest
+  // half turns, then the lowest angle, then the lowest slot
+  bool found = false;
+  int best_turns = 0;
+  AngleEntry best = { 0.0, 0u };
+  auto consider = [&](size_t i)
+                  {
+                    double dx = points.x(i) - px;
+                    double dy = points.y(i) - py;
+                    if (i == pivot_slot || (dx == 0.0 && dy == 0.0))
+                      return;
+
+                    AngleEntry entry = { ToHalfTurn(std::atan2(dy, dx)), (unsigned)i };
+                    int turns = half_turns + (entry.angle <= key ? 1 : 0);
+                    if (!found || turns < best_turns || 
+                        (turns == best_turns && (entry.angle < best.angle || 
+                                                 (entry.angle == best.angle && entry.slot < best.slot))))
+                    {
+                      found = true;
+                      best_turns = turns;
+                      best = entry;
+                    }
+                  };
+
+  // Turn from the line to each point (mod pi) as a diamond angle in float,
+  // which rises with the true angle from 0 to 2 but needs no atan2. The
+  // pivot and points on top of it come out as on the line.
+  const float* xs = points.xs();
+  const float* ys = points.ys();
+  float fx = (float)px;
+  float fy = (float)py;
+  float dir_x = (float)std::cos(start);
+  float dir_y = (float)std::sin(start);
+  auto pseudo_angle = [=](size_t i)
+                      {
+                        float dx = xs[i] - fx;
+                        float dy = ys[i] - fy;
+                        float c = dir_x * dy - dir_y * dx;
+                        float t = dir_x * dx + dir_y * dy;
+                        float q = std::fabs(c) / std::max(std::fabs(c) + std::fabs(t), FLT_MIN);
+                        // past a quarter turn when c and t differ in sign
+                        return 1.0f - std::copysign(1.0f - q, c * t);
+                      };
+
+  // The hit is either near the line, at either end of the pseudo-angles,
+  // where only the exact angle tells a point just ahead from one just
+  // behind, or has about the lowest pseudo-angle of the rest. Both are few,
+  // so only they get an atan2.
+  const float tolerance = scan_tolerance_;
+  float lowest = 3.0f;
+  std::vector<float> pseudo(scan_block_);
+  std::vector<unsigned> candidates;
+
+  auto near_line = [tolerance](float p)
+                   {
+                     return 1.0f - std::fabs(1.0f - p) <= tolerance;
+                   };
+
+  size_t count = points.size();
+  for (size_t base = 0; base < count; base += scan_block_)
+  {
+    size_t block = std::min(scan_block_, count - base);
+
+    // Lowest distance of the block's points from the line, in pseudo-angle.
+    // It is never negative, so its bits order the same and reduce with an
+    // integer min, which vectorizes where a float one does not.
+    int32_t block_nearest = INT32_MAX;
+    for (size_t j = 0; j < block; j++)
+    {
+      float p = pseudo_angle(base + j);
+      pseudo[j] = p;
+
+      float distance = 1.0f - std::fabs(1.0f - p);
+      int32_t bits;
+      memcpy(&bits, &distance, sizeof(bits));
+      block_nearest = std::min(block_nearest, bits);
+    }
+
+    float nearest;
+    memcpy(&nearest, &block_nearest, sizeof(nearest));
+    if (nearest > lowest + tolerance)
+      continue;
+
+    // rare: the block holds the line's neighbours or a new lowest
+    for (size_t j = 0; j < block; j++)
+    {
+      if (!near_line(pseudo[j]) && pseudo[j] < lowest)
+        lowest = pseudo[j];
+    }
+    for (size_t j = 0; j < block; j++)
+    {
+      if (near_line(pseudo[j]) || pseudo[j] <= lowest + tolerance)
+        candidates.push_back((unsigned)(base + j));
+    }
+  }
+
+  for (unsigned i : candidates)
+  {
+    float p = pseudo_angle(i);
+    if (near_line(p) || p <= lowest + tolerance)
+      consider(i);
+  }
+
+  if (!found)
+    return false;
+
+  slot = best.slot;
+  delta = best.angle + best_turns * M_PI - start;
+  return true;
+}
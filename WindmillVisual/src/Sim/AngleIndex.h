@@ -0,0 +1,146 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <math.h>
+#include <stdint.h>
+
+#include "PointStore.h"
+
+// Angle (mod pi) from a pivot to another point, with the point's slot in the
+// point list. A pivot's entries sorted by angle give the order in which the
+// rotating line hits the other points.
+struct AngleEntry
+{
+  double angle;
+  unsigned slot;
+};
+
+// Sorted angular orders for recently used pivots, evicted least recently used
+// first once their total size exceeds the memory budget. A pivot is answered
+// with linear scans until it has come up often enough for its sorted order
+// to pay off.
+class AngleIndex
+{
+private:
+
+  static const float scan_tolerance_;
+  static const size_t scan_block_;
+  static const uint8_t scans_per_sort_;
+
+  struct Order
+  {
+    std::vector<AngleEntry> entries;
+    std::list<PointId>::iterator lru_it;
+  };
+
+  std::unordered_map<PointId, Order> orders_;
+  std::list<PointId> lru_;
+
+  // by slot, how often each pivot's next hit has been scanned for
+  std::vector<uint8_t> scans_;
+
+  size_t memory_budget_;
+  size_t memory_used_;
+
+  void Evict();
+
+public:
+
+  AngleIndex(size_t memory_budget);
+
+  const std::vector<AngleEntry>* Find(PointId pivot_index);
+
+  // entries must already be sorted by angle
+  const std::vector<AngleEntry>& Insert(PointId pivot_index, std::vector<AngleEntry>&& entries);
+
+  // Next hit from the pivot at pivot_slot, by a scan on its first visits and
+  // from its cached order after that
+  bool NextHit(const PointStore& points, size_t pivot_slot, double rad, double epsilon,
+               unsigned& slot, double& delta);
+
+  void Clear();
+
+  void setMemoryBudget(size_t bytes);
+
+  size_t getMemoryUsed() const;
+
+  static void BuildOrder(const PointStore& points, size_t pivot_slot, std::vector<AngleEntry>& entries);
+
+  static double ToHalfTurn(double angle);
+
+  static bool NextHit(const std::vector<AngleEntry>& entries, double rad, double epsilon,
+                      unsigned& slot, double& delta);
+
+  // Same hit as the sorted order gives, found in O(n) without sorting
+  static bool ScanNextHit(const PointStore& points, size_t pivot_slot, double rad, double epsilon,
+                          unsigned& slot, double& delta);
+
+  // Finds the first of count sorted angles (mod pi) the line reaches when it
+  // turns on from rad. Angles within epsilon of the line are hit half a turn
+  // later.
+  template <typename AngleAt>
+  static bool NextHitIndex(size_t count, AngleAt angle_at, double rad, double epsilon,
+                           size_t& index, double& delta);
+
+  // As above, but searches with order_at, which may give any value on the
+  // same side of the key as the angle; angle_at is only asked for the hit's
+  template <typename OrderAt, typename AngleAt>
+  static bool NextHitIndex(size_t count, OrderAt order_at, AngleAt angle_at, double rad, double epsilon,
+                           size_t& index, double& delta);
+
+  // The angle NextHitIndex searches past: epsilon on from rad, mod pi
+  static double getHitKey(double rad, double epsilon);
+
+};
+
+
+template <typename AngleAt>
+bool AngleIndex::NextHitIndex(size_t count, AngleAt angle_at, double rad, double epsilon,
+                              size_t& index, double& delta)
+{
+  return NextHitIndex(count, angle_at, angle_at, rad, epsilon, index, delta);
+}
+
+
+template <typename OrderAt, typename AngleAt>
+bool AngleIndex::NextHitIndex(size_t count, OrderAt order_at, AngleAt angle_at, double rad, double epsilon,
+                              size_t& index, double& delta)
+{
+  if (count == 0)
+    return false;
+
+  double start = ToHalfTurn(rad);
+
+  double key = start + epsilon;
+  int half_turns = 0;
+  if (key >= M_PI)
+  {
+    key -= M_PI;
+    half_turns++;
+  }
+
+  // first angle past key
+  size_t lo = 0, hi = count;
+  while (lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+    if (order_at(mid) <= key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == count)
+  {
+    lo = 0;
+    half_turns++;
+  }
+
+  index = lo;
+  delta = angle_at(lo) + half_turns * M_PI - start;
+
+  return true;
+}
@@ -0,0 +1,313 @@
+#include "ArrowRenderer.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include "Coverage.h"
+
+
+const unsigned ArrowRenderer::vertices_per_arrow_ = 9u;
+
+const double ArrowRenderer::arrow_angle_ = 0.4;
+
+const int ArrowRenderer::octave_count_ = 64;
+
+const int ArrowRenderer::min_octave_ = -32;
+
+// without shaders, the colors of the whole path are redone once it has grown
+// by this fraction, the new arrows in between just take their place on it
+const size_t ArrowRenderer::recolor_growth_ = 16u;
+
+// A vertex holds the point it hangs off, its offset from there per unit of
+// size, and in its color the arrow's index (rgb) and whether the size is the
+// shaft thickness (a = 1) or the arrowhead size (a = 0)
+const char* ArrowRenderer::vertex_shader_ =
+  "uniform float thickness;\n"
+  "uniform float head_size;\n"
+  "uniform float last_index;\n"
+  "void main()\n"
+  "{\n"
+  "  float index = floor(dot(gl_Color.rgb, vec3(16711680.0, 65280.0, 255.0)) + 0.5);\n"
+  "  float size = gl_Color.a > 0.5 ? thickness : head_size;\n"
+  "  gl_Position = gl_ModelViewProjectionMatrix * vec4(gl_Vertex.xy + gl_MultiTexCoord0.xy * size, 0.0, 1.0);\n"
+  "  float t = min(index / last_index, 1.0);\n"
+  "  gl_FrontColor = vec4(30.0 * t, 90.0 * t, 90.0 * (1.0 - t), 255.0) / 255.0;\n"
+  "}\n";
+
+const char* ArrowRenderer::fragment_shader_ =
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = gl_Color;\n"
+  "}\n";
+
+
+ArrowRenderer::ArrowRenderer()
+  : octaves_(octave_count_)
+  , version_(0)
+  , colored_count_(0)
+  , first_unsynced_(0)
+  , thickness_(0.0f)
+  , head_size_(0.0f)
+  , shader_available_(sf::Shader::isAvailable())
+  , culled_first_octave_(0)
+  , culled_dirty_(true)
+{
+  if (shader_available_)
+    shader_available_ = shader_.loadFromMemory(vertex_shader_, fragment_shader_);
+}
+
+
+unsigned ArrowRenderer::getOctave(float length)
+{
+  if (!(length > 0.0f))
+    return 0;
+
+  return (unsigned)std::min(std::max(ilogbf(length) - min_octave_, 0), octave_count_ - 1);
+}
+
+
+unsigned ArrowRenderer::getFirstDrawnOctave(float pixel_size)
+{
+  // octave o is shorter than a pixel as a whole when 2^(o+1) <= pixel_size
+  if (!(pixel_size > 0.0f))
+    return 0;
+
+  return (unsigned)std::min(std::max(ilogbf(pixel_size) - min_octave_, 0), octave_count_);
+}
+
+
+sf::Vector2f ArrowRenderer::getMidpoint(const Arrow& arrow) const
+{
+  return arrow.tail + arrow.length / 2.0f * arrow.dir;
+}
+
+
+void ArrowRenderer::RebuildDensity(Octave& octave)
+{
+  float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+  for (unsigned i : octave.arrows)
+  {
+    sf::Vector2f mid = getMidpoint(arrows_[i]);
+    min_x = std::min(min_x, mid.x);
+    min_y = std::min(min_y, mid.y);
+    max_x = std::max(max_x, mid.x);
+    max_y = std::max(max_y, mid.y);
+  }
+
+  octave.density.Reset(min_x, min_y, max_x, max_y, octave.arrows.size());
+  for (unsigned i : octave.arrows)
+  {
+    sf::Vector2f mid = getMidpoint(arrows_[i]);
+    octave.density.Insert(mid.x, mid.y);
+  }
+}
+
+
+void ArrowRenderer::SetGeometry(size_t i)
+{
+  static const float cos_angle = (float)cos(arrow_angle_);
+  static const float sin_angle = (float)sin(arrow_angle_);
+
+  const Arrow& arrow = arrows_[i];
+  sf::Vector2f normal(-arrow.dir.y, arrow.dir.x);
+  sf::Vector2f tip = arrow.tail + arrow.length * arrow.dir;
+  sf::Vertex* v = &octaves_[arrow.octave].vertices[vertices_per_arrow_ * arrow.index];
+
+  // arrowhead, pulled back to around the middle of the shaft, then the shaft
+  // as two triangles, as offsets per unit of head size and thickness
+  sf::Vector2f mid = tip - arrow.length / 2.0f * arrow.dir;
+  sf::Vector2f head = 1.5f * arrow.dir;
+  sf::Vector2f side = normal / 2.0f;
+
+  const sf::Vector2f anchors[] = { mid, mid, mid, arrow.tail, tip, tip, arrow.tail, tip, arrow.tail };
+  const sf::Vector2f offsets[] = { head,
+                                   head - (cos_angle * arrow.dir + sin_angle * normal),
+                                   head - (cos_angle * arrow.dir - sin_angle * normal),
+                                   -side, -side, side, -side, side, side };
+
+  if (shader_available_)
+  {
+    // past 2^24 arrows the last ones share the end of the gradient
+    uint32_t index = (uint32_t)std::min<size_t>(i, 0xffffff);
+
+    for (unsigned k = 0; k < vertices_per_arrow_; k++)
+    {
+      v[k].position = anchors[k];
+      v[k].texCoords = offsets[k];
+      v[k].color = sf::Color((sf::Uint8)(index >> 16), (sf::Uint8)(index >> 8), (sf::Uint8)index,
+                             k < 3 ? 0 : 255);
+    }
+    return;
+  }
+
+  for (unsigned k = 0; k < vertices_per_arrow_; k++)
+    v[k].position = anchors[k] + (k < 3 ? head_size_ : thickness_) * offsets[k];
+}
+
+
+void ArrowRenderer::SetColors(size_t first)
+{
+  // the gradient runs over the whole path
+  size_t s = arrows_.size();
+  for (size_t i = first; i < s; i++)
+  {
+    float t = s != 1 ? (float)i / (s-1) : 0;
+    sf::Color color((int)(30 * t), (int)(90 * t), (int)(90 * (1.0f - t)));
+
+    const Arrow& arrow = arrows_[i];
+    sf::Vertex* v = &octaves_[arrow.octave].vertices[vertices_per_arrow_ * arrow.index];
+    for (unsigned k = 0; k < vertices_per_arrow_; k++)
+      v[k].color = color;
+  }
+}
+
+
+void ArrowRenderer::Clear()
+{
+  arrows_.clear();
+  for (Octave& octave : octaves_)
+  {
+    octave.arrows.clear();
+    octave.vertices.clear();
+    octave.density.Clear();
+  }
+  colored_count_ = 0;
+  first_unsynced_ = 0;
+  grid_.Clear();
+  culled_dirty_ = true;
+  version_++;
+}
+
+
+void ArrowRenderer::Add(Vec2 from, Vec2 to)
+{
+  sf::Vector2f tail(from.x, from.y);
+  sf::Vector2f diff = sf::Vector2f(to.x, to.y) - tail;
+  float length = std::sqrt(diff.x * diff.x + diff.y * diff.y);
+
+  Arrow arrow = { tail, length > 0.0f ? diff / length : sf::Vector2f(0.0f, -1.0f), length, getOctave(length), 0 };
+  Octave& octave = octaves_[arrow.octave];
+  arrow.index = (unsigned)octave.arrows.size();
+
+  octave.arrows.push_back((unsigned)arrows_.size());
+  octave.vertices.resize(octave.vertices.size() + vertices_per_arrow_);
+  arrows_.push_back(arrow);
+
+  sf::Vector2f mid = getMidpoint(arrow);
+  if (!octave.density.Insert(mid.x, mid.y))
+    RebuildDensity(octave);
+
+  grid_.Add(from.x, from.y, to.x, to.y);
+  culled_dirty_ = true;
+  version_++;
+}
+
+
+void ArrowRenderer::Sync(float thickness, float head_size)
+{
+  bool resized = thickness != thickness_ || head_size != head_size_;
+  thickness_ = thickness;
+  head_size_ = head_size;
+
+  size_t first_new = first_unsynced_;
+  first_unsynced_ = arrows_.size();
+
+  // the shader takes the sizes as they are
+  if (shader_available_)
+    resized = false;
+
+  if (resized)
+    culled_dirty_ = true;
+
+  for (size_t i = resized ? 0 : first_new; i < arrows_.size(); i++)
+    SetGeometry(i);
+
+  if (shader_available_ || first_new == arrows_.size())
+    return;
+
+  if (arrows_.size() >= colored_count_ + colored_count_ / recolor_growth_ + 1)
+  {
+    SetColors(0);
+    colored_count_ = arrows_.size();
+  }
+  else
+  {
+    SetColors(first_new);
+  }
+}
+
+
+size_t ArrowRenderer::Draw(sf::RenderTarget& target, const sf::FloatRect& view, float pixel_size)
+{
+  if (arrows_.empty())
+    return 0;
+
+  sf::RenderStates states;
+  if (shader_available_)
+  {
+    shader_.setUniform("thickness", thickness_);
+    shader_.setUniform("head_size", head_size_);
+    shader_.setUniform("last_index", (float)std::max<size_t>(std::min<size_t>(arrows_.size() - 1, 0xffffff), 1));
+    states.shader = &shader_;
+  }
+
+  unsigned first_octave = getFirstDrawnOctave(pixel_size);
+
+  // arrowheads and thick shafts reach a little past the segments
+  float margin = 2.0f * head_size_ + thickness_;
+  float min_x = view.left - margin, min_y = view.top - margin;
+  float max_x = view.left + view.width + margin, max_y = view.top + view.height + margin;
+
+  if (isFullDrawCheaper(grid_.getCoverage(min_x, min_y, max_x, max_y)))
+  {
+    size_t drawn = 0;
+    for (size_t o = first_octave; o < octaves_.size(); o++)
+    {
+      const Octave& octave = octaves_[o];
+      if (octave.vertices.empty())
+        continue;
+
+      target.draw(octave.vertices.data(), octave.vertices.size(), sf::Triangles, states);
+      drawn += octave.arrows.size();
+    }
+    return drawn;
+  }
+
+  if (culled_dirty_ || view != culled_view_ || first_octave != culled_first_octave_)
+  {
+    culled_dirty_ = false;
+    culled_view_ = view;
+    culled_first_octave_ = first_octave;
+
+    grid_.Query(min_x, min_y, max_x, max_y, culled_indices_);
+
+    culled_.clear();
+    for (unsigned i : culled_indices_)
+    {
+      const Arrow& arrow = arrows_[i];
+      if (arrow.octave < first_octave)
+        continue;
+
+      const sf::Vertex* v = &octaves_[arrow.octave].vertices[vertices_per_arrow_ * arrow.index];
+      culled_.insert(culled_.end(), v, v + vertices_per_arrow_);
+    }
+  }
+
+  if (!culled_.empty())
+    target.draw(culled_.data(), culled_.size(), sf::Triangles, states);
+
+  return culled_.size() / vertices_per_arrow_;
+}
+
+
+void ArrowRenderer::getShortArrows(float pixel_size, std::vector<const DensityPyramid*>& densities) const
+{
+  densities.clear();
+
+  unsigned first_octave = getFirstDrawnOctave(pixel_size);
+  for (unsigned o = 0; o < first_octave; o++)
+  {
+    if (octaves_[o].density.size() > 0)
+      densities.push_back(&octaves_[o].density);
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include <SFML/Graphics.hpp>
+
+#include "Vec2.h"
+#include "SegmentGrid.h"
+#include "DensityPyramid.h"
+
+// The pivot's path as arrows, kept in a vertex array per octave of arrow
+// length. Each arrow's vertices are written once when it's added: a vertex
+// shader spreads them by the shaft thickness and arrowhead size and colors
+// them by the arrow's index along the path, so neither a zoom nor a new
+// arrow touches the others. Without shaders a zoom moves every vertex and
+// the colors are redone whenever the path has grown by a sixteenth. Zoomed
+// in on a long path, only the arrows found through a segment grid are
+// drawn. Octaves of arrows shorter than a pixel are left out and handed
+// over as density pyramids of their midpoints instead.
+class ArrowRenderer
+{
+private:
+
+  static const unsigned vertices_per_arrow_;
+  static const double arrow_angle_;
+  static const int octave_count_;
+  static const int min_octave_;
+  static const size_t recolor_growth_;
+  static const char* vertex_shader_;
+  static const char* fragment_shader_;
+
+  struct Arrow
+  {
+    sf::Vector2f tail;
+    sf::Vector2f dir;
+    float length;
+    unsigned octave;
+    unsigned index; // within its octave
+  };
+
+  // the arrows of lengths in [2^o, 2^(o+1)) for octave o, offset by min_octave_
+  struct Octave
+  {
+    std::vector<unsigned> arrows;
+    std::vector<sf::Vertex> vertices;
+    DensityPyramid density;
+  };
+
+  std::vector<Arrow> arrows_;
+  std::vector<Octave> octaves_;
+  uint64_t version_;
+
+  size_t colored_count_;
+  size_t first_unsynced_;
+  float thickness_;
+  float head_size_;
+
+  sf::Shader shader_;
+  bool shader_available_;
+
+  SegmentGrid grid_;
+
+  // the visible arrows' vertices, kept until the view or arrows change
+  std::vector<sf::Vertex> culled_;
+  std::vector<unsigned> culled_indices_;
+  sf::FloatRect culled_view_;
+  unsigned culled_first_octave_;
+  bool culled_dirty_;
+
+  static unsigned getOctave(float length);
+
+  // first octave whose arrows can all be longer than a pixel
+  static unsigned getFirstDrawnOctave(float pixel_size);
+
+  sf::Vector2f getMidpoint(const Arrow& arrow) const;
+
+  void RebuildDensity(Octave& octave);
+
+  void SetGeometry(size_t i);
+
+  // Colors the arrows from first on along the gradient, without shaders
+  void SetColors(size_t first);
+
+public:
+
+  ArrowRenderer();
+
+  void Clear();
+
+  // Appends an arrow; its vertices are written by the next Sync
+  void Add(Vec2 from, Vec2 to);
+
+  // Writes the vertices of the arrows added since the last call, and moves
+  // the others when the sizes change
+  void Sync(float thickness, float head_size);
+
+  // Returns the number of arrows drawn, leaving out those shorter than a pixel
+  size_t Draw(sf::RenderTarget& target, const sf::FloatRect& view, float pixel_size);
+
+  // The densities of the arrows Draw leaves out
+  void getShortArrows(float pixel_size, std::vector<const DensityPyramid*>& densities) const;
+
+  size_t getCount() const { return arrows_.size(); }
+
+  // Changes whenever arrows are added or cleared
+  uint64_t getVersion() const { return version_; }
+
+};
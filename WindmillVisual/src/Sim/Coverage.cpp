@@ -0,0 +1,33 @@
+#include "Coverage.h"
+
+#include <algorithm>
+
+
+static const float full_draw_coverage = 0.5f;
+
+
+float getBoxCoverage(float box_min_x, float box_min_y, float box_max_x, float box_max_y,
+                     float min_x, float min_y, float max_x, float max_y)
+{
+  double width = (double)box_max_x - box_min_x;
+  double height = (double)box_max_y - box_min_y;
+  double inside_w = std::min<double>(max_x, box_max_x) - std::max<double>(min_x, box_min_x);
+  double inside_h = std::min<double>(max_y, box_max_y) - std::max<double>(min_y, box_min_y);
+
+  if (inside_w < 0.0 || inside_h < 0.0)
+    return 0.0f;
+
+  double coverage = 1.0;
+  if (width > 0.0)
+    coverage *= inside_w / width;
+  if (height > 0.0)
+    coverage *= inside_h / height;
+
+  return (float)coverage;
+}
+
+
+bool isFullDrawCheaper(float coverage)
+{
+  return coverage > full_draw_coverage;
+}
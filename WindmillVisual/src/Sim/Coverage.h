@@ -0,0 +1,11 @@
+#pragma once
+
+// Fraction of the box (box_min_x, box_min_y)-(box_max_x, box_max_y) inside
+// the rectangle, as a cheap estimate of how much of what the box holds is in
+// it. A degenerate box counts along the dimensions it has
+float getBoxCoverage(float box_min_x, float box_min_y, float box_max_x, float box_max_y,
+                     float min_x, float min_y, float max_x, float max_y);
+
+// Whether a view covering this much of a scene is drawn cheaper whole,
+// leaving the GPU to clip the rest, than through a grid query
+bool isFullDrawCheaper(float coverage);
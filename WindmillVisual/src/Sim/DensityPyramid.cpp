@@ -0,0 +1,139 @@
+#include "DensityPyramid.h"
+
+#include <algorithm>
+
+
+const unsigned DensityPyramid::min_resolution_ = 16u;
+
+const unsigned DensityPyramid::max_resolution_ = 4096u;
+
+const float DensityPyramid::margin_ = 0.5f;
+
+
+DensityPyramid::DensityPyramid()
+  : resolution_(0)
+  , min_x_(0.0f)
+  , min_y_(0.0f)
+  , cell_size_(1.0f)
+  , count_(0)
+  , built_count_(0)
+{
+}
+
+
+bool DensityPyramid::getCell(float x, float y, unsigned& cx, unsigned& cy) const
+{
+  double fx = std::floor(((double)x - min_x_) / cell_size_);
+  double fy = std::floor(((double)y - min_y_) / cell_size_);
+  if (!(fx >= 0.0 && fy >= 0.0 && fx < resolution_ && fy < resolution_))
+    return false;
+
+  cx = (unsigned)fx;
+  cy = (unsigned)fy;
+  return true;
+}
+
+
+bool DensityPyramid::Insert(float x, float y)
+{
+  // a finer resolution pays off once the count has grown enough
+  if (resolution_ < max_resolution_ && count_ >= 4 * std::max<size_t>(built_count_, min_resolution_))
+    return false;
+
+  unsigned cx, cy;
+  if (!getCell(x, y, cx, cy))
+    return false;
+
+  for (size_t level = 0; level < levels_.size(); level++)
+  {
+    unsigned res = resolution_ >> level;
+    levels_[level][(size_t)(cy >> level) * res + (cx >> level)]++;
+  }
+
+  count_++;
+  return true;
+}
+
+
+void DensityPyramid::Remove(float x, float y)
+{
+  unsigned cx, cy;
+  if (count_ == 0 || !getCell(x, y, cx, cy))
+    return;
+
+  for (size_t level = 0; level < levels_.size(); level++)
+  {
+    unsigned res = resolution_ >> level;
+    uint32_t& cell = levels_[level][(size_t)(cy >> level) * res + (cx >> level)];
+    if (cell > 0)
+      cell--;
+  }
+
+  count_--;
+}
+
+
+void DensityPyramid::Reset(float min_x, float min_y, float max_x, float max_y, size_t count)
+{
+  // a couple of finest cells per point, if the points were spread evenly
+  unsigned resolution = min_resolution_;
+  while (resolution < max_resolution_ && (double)resolution * resolution < 4.0 * count)
+    resolution *= 2;
+
+  double side = std::max((double)max_x - min_x, (double)max_y - min_y) * (1.0 + 2.0 * margin_);
+  if (!(side > 0.0))
+    side = 1.0;
+
+  cell_size_ = (float)(side / resolution);
+  min_x_ = (float)(((double)min_x + max_x - side) / 2.0);
+  min_y_ = (float)(((double)min_y + max_y - side) / 2.0);
+  resolution_ = resolution;
+
+  levels_.clear();
+  for (unsigned res = resolution; res > 0; res /= 2)
+    levels_.emplace_back((size_t)res * res, 0u);
+
+  count_ = 0;
+  built_count_ = count;
+}
+
+
+void DensityPyramid::Clear()
+{
+  levels_.clear();
+  resolution_ = 0;
+  count_ = built_count_ = 0;
+}
+
+
+size_t DensityPyramid::getLevelFor(float cell_size) const
+{
+  size_t level = 0;
+  while (level + 1 < levels_.size() && getCellSize(level + 1) <= cell_size)
+    level++;
+
+  return level;
+}
+
+
+size_t DensityPyramid::CountRect(float min_x, float min_y, float max_x, float max_y) const
+{
+  size_t count = 0;
+  QueryRect(getLevelFor(std::max(max_x - min_x, max_y - min_y) / 8.0f), min_x, min_y, max_x, max_y,
+            [&count](float, float, float, uint32_t cell)
+            {
+              count += cell;
+            });
+
+  return count;
+}
+
+
+size_t DensityPyramid::getMemoryUsed() const
+{
+  size_t bytes = levels_.capacity() * sizeof(std::vector<uint32_t>);
+  for (const auto& level : levels_)
+    bytes += level.capacity() * sizeof(uint32_t);
+
+  return bytes;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+// Point counts over a square of cells, at every resolution from the finest
+// level down to a single cell, each level halving the one before. Adding or
+// removing a point touches one cell per level. The square is laid over the
+// points' bounding box with room to spare and its resolution follows the
+// point count; when a point falls outside or the count has grown by a factor
+// of four, Insert refuses it and the owner resets the pyramid with all of
+// its points.
+class DensityPyramid
+{
+private:
+
+  static const unsigned min_resolution_;
+  static const unsigned max_resolution_;
+  static const float margin_;
+
+  // levels_[0] is the finest, row major
+  std::vector<std::vector<uint32_t>> levels_;
+  unsigned resolution_;
+  float min_x_, min_y_;
+  float cell_size_;
+
+  size_t count_;
+  size_t built_count_;
+
+  bool getCell(float x, float y, unsigned& cx, unsigned& cy) const;
+
+public:
+
+  DensityPyramid();
+
+  size_t size() const { return count_; }
+
+  // Returns false, counting nothing, when the pyramid has to be reset first
+  bool Insert(float x, float y);
+
+  void Remove(float x, float y);
+
+  // Lays the pyramid over the box, sized for count points, and zeroes it;
+  // every point has to be inserted again
+  void Reset(float min_x, float min_y, float max_x, float max_y, size_t count);
+
+  void Clear();
+
+  size_t getLevelCount() const { return levels_.size(); }
+
+  float getCellSize(size_t level) const { return ldexpf(cell_size_, (int)level); }
+
+  // Coarsest level whose cells are no larger than cell_size, or the finest
+  size_t getLevelFor(float cell_size) const;
+
+  // Calls f(x, y, size, count) with the corner, side and count of every
+  // non-empty cell of the level touching the rectangle
+  template <typename F>
+  void QueryRect(size_t level, float min_x, float min_y, float max_x, float max_y, F f) const;
+
+  // Points in the cells touching the rectangle, from a level coarse enough
+  // to take a few dozen cells
+  size_t CountRect(float min_x, float min_y, float max_x, float max_y) const;
+
+  size_t getMemoryUsed() const;
+
+};
+
+
+template <typename F>
+void DensityPyramid::QueryRect(size_t level, float min_x, float min_y, float max_x, float max_y, F f) const
+{
+  if (count_ == 0 || level >= levels_.size())
+    return;
+
+  unsigned res = resolution_ >> level;
+  float size = getCellSize(level);
+
+  double x0 = std::floor(((double)min_x - min_x_) / size), x1 = std::floor(((double)max_x - min_x_) / size);
+  double y0 = std::floor(((double)min_y - min_y_) / size), y1 = std::floor(((double)max_y - min_y_) / size);
+  if (x1 < 0.0 || y1 < 0.0 || x0 >= res || y0 >= res)
+    return;
+
+  unsigned cx0 = (unsigned)std::max(x0, 0.0), cx1 = (unsigned)std::min(x1, res - 1.0);
+  unsigned cy0 = (unsigned)std::max(y0, 0.0), cy1 = (unsigned)std::min(y1, res - 1.0);
+
+  const std::vector<uint32_t>& counts = levels_[level];
+  for (unsigned cy = cy0; cy <= cy1; cy++)
+  {
+    const uint32_t* row = &counts[(size_t)cy * res];
+    for (unsigned cx = cx0; cx <= cx1; cx++)
+    {
+      if (row[cx] != 0)
+        f(min_x_ + cx * size, min_y_ + cy * size, size, row[cx]);
+    }
+  }
+}
@@ -0,0 +1,153 @@
+#include "DensityRenderer.h"
+
+#include <algorithm>
+#include <math.h>
+
+
+const float DensityRenderer::texel_pixels_ = 2.0f;
+
+const sf::Color DensityRenderer::point_color_ = sf::Color(255, 255, 255);
+
+const sf::Color DensityRenderer::arrow_color_ = sf::Color(40, 140, 160);
+
+
+DensityRenderer::DensityRenderer()
+  : width_(0)
+  , height_(0)
+  , origin_x_(0.0f)
+  , origin_y_(0.0f)
+  , texel_size_(0.0f)
+  , points_version_((uint64_t)-1)
+  , arrows_version_((uint64_t)-1)
+  , dirty_(false)
+{
+}
+
+
+bool DensityRenderer::Begin(const sf::FloatRect& view, float pixel_size,
+                            uint64_t points_version, uint64_t arrows_version)
+{
+  float texel_size = getTexelSize(pixel_size);
+
+  if (width_ != 0 && view == view_ && texel_size == texel_size_ &&
+      points_version == points_version_ && arrows_version == arrows_version_)
+    return false;
+
+  view_ = view;
+  texel_size_ = texel_size;
+  points_version_ = points_version;
+  arrows_version_ = arrows_version;
+
+  // texels stay on a fixed world grid, so panning doesn't make them shimmer
+  origin_x_ = std::floor(view.left / texel_size) * texel_size;
+  origin_y_ = std::floor(view.top / texel_size) * texel_size;
+  width_ = (unsigned)std::ceil((view.left + view.width - origin_x_) / texel_size) + 1;
+  height_ = (unsigned)std::ceil((view.top + view.height - origin_y_) / texel_size) + 1;
+
+  for (auto& counts : counts_)
+    counts.assign((size_t)width_ * height_, 0.0f);
+
+  dirty_ = true;
+  return true;
+}
+
+
+void DensityRenderer::Splat(std::vector<float>& counts, float x, float y, float size, float count)
+{
+  // a small cell lands on the texel holding its center
+  if (size <= texel_size_)
+  {
+    int tx = (int)std::floor((x + size / 2.0f - origin_x_) / texel_size_);
+    int ty = (int)std::floor((y + size / 2.0f - origin_y_) / texel_size_);
+    if (tx >= 0 && ty >= 0 && tx < (int)width_ && ty < (int)height_)
+      counts[(size_t)ty * width_ + tx] += count;
+    return;
+  }
+
+  // a large one is spread over the texels it covers
+  int tx0 = std::max((int)std::floor((x - origin_x_) / texel_size_), 0);
+  int ty0 = std::max((int)std::floor((y - origin_y_) / texel_size_), 0);
+  int tx1 = std::min((int)std::ceil((x + size - origin_x_) / texel_size_), (int)width_);
+  int ty1 = std::min((int)std::ceil((y + size - origin_y_) / texel_size_), (int)height_);
+
+  float share = count * (texel_size_ / size) * (texel_size_ / size);
+  for (int ty = ty0; ty < ty1; ty++)
+  {
+    for (int tx = tx0; tx < tx1; tx++)
+      counts[(size_t)ty * width_ + tx] += share;
+  }
+}
+
+
+void DensityRenderer::Accumulate(const DensityPyramid& pyramid, Layer layer)
+{
+  std::vector<float>& counts = counts_[(int)layer];
+  size_t level = pyramid.getLevelFor(texel_size_);
+
+  pyramid.QueryRect(level, origin_x_, origin_y_, origin_x_ + width_ * texel_size_, origin_y_ + height_ * texel_size_,
+                    [&](float x, float y, float size, uint32_t count)
+                    {
+                      Splat(counts, x, y, size, (float)count);
+                    });
+
+  dirty_ = true;
+}
+
+
+void DensityRenderer::Colorize()
+{
+  // log scaled against the densest texel, so sparse areas still show
+  float scale[2];
+  for (int l = 0; l < 2; l++)
+  {
+    float max_count = 0.0f;
+    for (float c : counts_[l])
+      max_count = std::max(max_count, c);
+    scale[l] = max_count > 0.0f ? 1.0f / std::log1p(max_count) : 0.0f;
+  }
+
+  pixels_.resize(4 * (size_t)width_ * height_);
+
+  for (size_t i = 0; i < (size_t)width_ * height_; i++)
+  {
+    float p = counts_[0][i] > 0.0f ? 0.25f + 0.75f * std::log1p(counts_[0][i]) * scale[0] : 0.0f;
+    float a = counts_[1][i] > 0.0f ? 0.25f + 0.75f * std::log1p(counts_[1][i]) * scale[1] : 0.0f;
+
+    sf::Uint8* pixel = &pixels_[4 * i];
+    if (p + a == 0.0f)
+    {
+      pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+      continue;
+    }
+
+    // points over arrows, each in proportion to how dense it is
+    float w = p / (p + a);
+    pixel[0] = (sf::Uint8)(w * point_color_.r + (1.0f - w) * arrow_color_.r);
+    pixel[1] = (sf::Uint8)(w * point_color_.g + (1.0f - w) * arrow_color_.g);
+    pixel[2] = (sf::Uint8)(w * point_color_.b + (1.0f - w) * arrow_color_.b);
+    pixel[3] = (sf::Uint8)(255.0f * std::min(std::max(p, a), 1.0f));
+  }
+}
+
+
+void DensityRenderer::Draw(sf::RenderTarget& target)
+{
+  if (width_ == 0)
+    return;
+
+  if (dirty_)
+  {
+    dirty_ = false;
+    Colorize();
+
+    if (texture_.getSize() != sf::Vector2u(width_, height_))
+      texture_.create(width_, height_);
+    texture_.update(pixels_.data());
+
+    sprite_.setTexture(texture_, true);
+    sprite_.setPosition(origin_x_, origin_y_);
+    sprite_.setScale(texel_size_, texel_size_);
+  }
+
+  target.draw(sprite_);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include <SFML/Graphics.hpp>
+
+#include "DensityPyramid.h"
+
+// Counts from density pyramids gathered into a texture laid over the view,
+// a texel every couple of pixels, and drawn as a single quad. Stands in for
+// points and arrows too small and too many to draw one by one, so its cost
+// follows the window size rather than the scene. The texture is only
+// rebuilt when the view or what was gathered into it changes.
+class DensityRenderer
+{
+public:
+
+  enum class Layer
+  {
+    kPoints,
+    kArrows
+  };
+
+private:
+
+  static const float texel_pixels_;
+  static const sf::Color point_color_;
+  static const sf::Color arrow_color_;
+
+  // counts per texel, one array per layer
+  std::vector<float> counts_[2];
+  std::vector<sf::Uint8> pixels_;
+
+  sf::Texture texture_;
+  sf::Sprite sprite_;
+
+  unsigned width_, height_;
+  float origin_x_, origin_y_;
+  float texel_size_;
+
+  sf::FloatRect view_;
+  uint64_t points_version_;
+  uint64_t arrows_version_;
+  bool dirty_;
+
+  void Splat(std::vector<float>& counts, float x, float y, float size, float count);
+
+  void Colorize();
+
+public:
+
+  DensityRenderer();
+
+  static float getTexelSize(float pixel_size) { return pixel_size * texel_pixels_; }
+
+  // Lays a fresh map over the view, unless it is the one last drawn and the
+  // versions match. Returns whether the layers have to be accumulated again
+  bool Begin(const sf::FloatRect& view, float pixel_size,
+             uint64_t points_version, uint64_t arrows_version);
+
+  void Accumulate(const DensityPyramid& pyramid, Layer layer);
+
+  void Draw(sf::RenderTarget& target);
+
+};
@@ -0,0 +1,104 @@
+#include "EdgeSet.h"
+
+#include <algorithm>
+
+
+const size_t EdgeSet::min_table_size_ = 64u;
+
+// linear probing stays short well below this
+const size_t EdgeSet::max_load_percent_ = 50u;
+
+const size_t EdgeSet::no_edge_ = (size_t)(-1);
+
+
+EdgeSet::EdgeSet()
+  : table_(min_table_size_, 0u)
+  , mask_(min_table_size_ - 1)
+{
+}
+
+
+size_t EdgeSet::getHash(uint32_t from, uint32_t to)
+{
+  // slots are small and dense, so mix them well before masking
+  uint64_t key = ((uint64_t)from << 32) | to;
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  return (size_t)key;
+}
+
+
+void EdgeSet::Grow()
+{
+  table_.assign(table_.size() * 2, 0u);
+  mask_ = table_.size() - 1;
+
+  for (size_t i = 0; i < edges_.size(); i++)
+  {
+    size_t t = getHash(edges_[i].from, edges_[i].to) & mask_;
+    while (table_[t] != 0)
+      t = (t + 1) & mask_;
+
+    table_[t] = (uint32_t)(i + 1);
+  }
+}
+
+
+bool EdgeSet::Visit(uint32_t from, uint32_t to)
+{
+  size_t t = getHash(from, to) & mask_;
+  for (; table_[t] != 0; t = (t + 1) & mask_)
+  {
+    size_t i = table_[t] - 1;
+    if (edges_[i].from == from && edges_[i].to == to)
+    {
+      visits_[i]++;
+      return false;
+    }
+  }
+
+  table_[t] = (uint32_t)(edges_.size() + 1);
+  edges_.push_back({ from, to });
+  visits_.push_back(1u);
+
+  if (edges_.size() * 100 > table_.size() * max_load_percent_)
+    Grow();
+
+  return true;
+}
+
+
+size_t EdgeSet::Find(uint32_t from, uint32_t to) const
+{
+  for (size_t t = getHash(from, to) & mask_; table_[t] != 0; t = (t + 1) & mask_)
+  {
+    size_t i = table_[t] - 1;
+    if (edges_[i].from == from && edges_[i].to == to)
+      return i;
+  }
+
+  return no_edge_;
+}
+
+
+void EdgeSet::Clear()
+{
+  edges_.clear();
+  visits_.clear();
+
+  // a long path's table is not worth keeping around
+  if (table_.size() > min_table_size_)
+    std::vector<uint32_t>(min_table_size_, 0u).swap(table_);
+  else
+    std::fill(table_.begin(), table_.end(), 0u);
+  mask_ = min_table_size_ - 1;
+}
+
+
+size_t EdgeSet::getMemoryUsed() const
+{
+  return edges_.capacity() * sizeof(PathEdge) +
+         visits_.capacity() * sizeof(uint32_t) +
+         table_.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// A step of the pivot's path, from one point to the next, named by slot.
+// The path is cleared whenever points are added, deleted or moved, so the
+// slots stay put for as long as it lasts
+struct PathEdge
+{
+  uint32_t from;
+  uint32_t to;
+};
+
+// The distinct edges of the path in the order they were first taken, with
+// how often each was taken. An open addressing table of edge indices,
+// probed linearly, finds an edge in constant time, so a switch costs the
+// same however long the path already is.
+class EdgeSet
+{
+private:
+
+  static const size_t min_table_size_;
+  static const size_t max_load_percent_;
+
+  std::vector<PathEdge> edges_;
+  std::vector<uint32_t> visits_;
+
+  // index + 1 of the edge hashed there, 0 when empty
+  std::vector<uint32_t> table_;
+  size_t mask_;
+
+  static size_t getHash(uint32_t from, uint32_t to);
+
+  void Grow();
+
+public:
+
+  static const size_t no_edge_;
+
+  EdgeSet();
+
+  // Counts a visit to the edge. Returns true if it wasn't in the set yet
+  bool Visit(uint32_t from, uint32_t to);
+
+  // Returns the edge's index, or no_edge_
+  size_t Find(uint32_t from, uint32_t to) const;
+
+  void Clear();
+
+  size_t size() const { return edges_.size(); }
+
+  bool empty() const { return edges_.empty(); }
+
+  const PathEdge& operator[](size_t i) const { return edges_[i]; }
+
+  const std::vector<PathEdge>& getEdges() const { return edges_; }
+
+  uint32_t getVisits(size_t i) const { return visits_[i]; }
+
+  size_t getMemoryUsed() const;
+
+};
@@ -0,0 +1,290 @@
+#include "PointRenderer.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include "Coverage.h"
+
+
+const float PointRenderer::outline_proportion_ = 0.3f;
+
+const unsigned PointRenderer::texture_size_ = 64u;
+
+// moves each corner out from the point by half_size, telling the corners
+// apart by their texture coordinates
+const char* PointRenderer::vertex_shader_ =
+  "uniform float half_size;\n"
+  "void main()\n"
+  "{\n"
+  "  vec4 tex = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+  "  vec2 corner = (tex.xy * 2.0 - 1.0) * half_size;\n"
+  "  gl_Position = gl_ModelViewProjectionMatrix * vec4(gl_Vertex.xy + corner, 0.0, 1.0);\n"
+  "  gl_TexCoord[0] = tex;\n"
+  "  gl_FrontColor = gl_Color;\n"
+  "}\n";
+
+const char* PointRenderer::fragment_shader_ =
+  "uniform sampler2D texture;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = gl_Color * texture2D(texture, gl_TexCoord[0].xy);\n"
+  "}\n";
+
+
+PointRenderer::PointRenderer()
+  : shader_available_(sf::Shader::isAvailable())
+  , buffer_(sf::Quads, sf::VertexBuffer::Static)
+  , buffer_available_(sf::VertexBuffer::isAvailable())
+  , version_((uint64_t)-1)
+  , radius_(0.0f)
+  , culled_version_((uint64_t)-1)
+  , culled_radius_(0.0f)
+{
+  CreateTexture();
+
+  if (shader_available_)
+  {
+    shader_available_ = shader_.loadFromMemory(vertex_shader_, fragment_shader_);
+    shader_.setUniform("texture", sf::Shader::CurrentTexture);
+  }
+}
+
+
+void PointRenderer::CreateTexture()
+{
+  // a white ring, from the point's radius out to the edge of the texture
+  float outer = texture_size_ / 2.0f;
+  float inner = outer / (1.0f + outline_proportion_);
+  const int samples = 4;
+
+  sf::Image image;
+  image.create(texture_size_, texture_size_, sf::Color::Transparent);
+
+  for (unsigned y = 0; y < texture_size_; y++)
+  {
+    for (unsigned x = 0; x < texture_size_; x++)
+    {
+      // supersampled coverage, for smooth edges
+      int covered = 0;
+      for (int sy = 0; sy < samples; sy++)
+      {
+        for (int sx = 0; sx < samples; sx++)
+        {
+          float dx = x + (sx + 0.5f) / samples - outer;
+          float dy = y + (sy + 0.5f) / samples - outer;
+          float dist = std::sqrt(dx * dx + dy * dy);
+          covered += dist >= inner && dist <= outer;
+        }
+      }
+
+      image.setPixel(x, y, sf::Color(255, 255, 255, (sf::Uint8)(255 * covered / (samples * samples))));
+    }
+  }
+
+  texture_.loadFromImage(image);
+  texture_.setSmooth(true);
+  texture_.generateMipmap();
+}
+
+
+void PointRenderer::WriteQuad(sf::Vertex* v, float x, float y) const
+{
+  // the shader spreads the corners out
+  float half = shader_available_ ? 0.0f : radius_ * (1.0f + outline_proportion_);
+  float tex = (float)texture_size_;
+
+  v[0] = sf::Vertex({ x - half, y - half }, { 0.0f, 0.0f });
+  v[1] = sf::Vertex({ x + half, y - half }, { tex, 0.0f });
+  v[2] = sf::Vertex({ x + half, y + half }, { tex, tex });
+  v[3] = sf::Vertex({ x - half, y + half }, { 0.0f, tex });
+}
+
+
+void PointRenderer::SetQuad(size_t quad)
+{
+  WriteQuad(&vertices_[4 * quad], centers_[quad].x, centers_[quad].y);
+}
+
+
+void PointRenderer::Rebuild(const PointStore& points)
+{
+  size_t n = points.size();
+
+  vertices_.resize(4 * n);
+  centers_.resize(n);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    centers_[i] = { points.x(i), points.y(i) };
+    SetQuad(i);
+  }
+
+  version_ = points.getVersion();
+
+  Upload(0, n);
+}
+
+
+void PointRenderer::Rescale()
+{
+  for (size_t i = 0; i < centers_.size(); i++)
+    SetQuad(i);
+
+  Upload(0, centers_.size());
+}
+
+
+void PointRenderer::Upload(size_t first_quad, size_t quad_count)
+{
+  if (!buffer_available_ || quad_count == 0)
+    return;
+
+  if (buffer_.getVertexCount() < vertices_.size())
+  {
+    // grow geometrically so adding points one by one stays cheap
+    if (!buffer_.create(std::max(vertices_.size(), 2 * buffer_.getVertexCount())))
+    {
+      buffer_available_ = false;
+      return;
+    }
+    first_quad = 0;
+    quad_count = centers_.size();
+  }
+
+  buffer_.update(&vertices_[4 * first_quad], 4 * quad_count, (unsigned)(4 * first_quad));
+}
+
+
+bool PointRenderer::isInSync(const PointStore& points) const
+{
+  return version_ == points.getVersion();
+}
+
+
+void PointRenderer::Sync(const PointStore& points, float radius)
+{
+  bool rescale = radius != radius_;
+  radius_ = radius;
+
+  if (!isInSync(points))
+    Rebuild(points);
+  else if (rescale && !shader_available_)
+    Rescale();
+}
+
+
+void PointRenderer::Add(const PointStore& points, size_t first_slot)
+{
+  size_t count = points.size() - first_slot;
+
+  vertices_.resize(4 * points.size());
+  centers_.resize(points.size());
+  for (size_t slot = first_slot; slot < points.size(); slot++)
+  {
+    centers_[slot] = { points.x(slot), points.y(slot) };
+    SetQuad(slot);
+  }
+
+  version_ = points.getVersion();
+
+  Upload(first_slot, count);
+}
+
+
+void PointRenderer::Remove(const PointStore& points, const std::vector<size_t>& erased_slots)
+{
+  // the last quad fills each hole; the holes left inside the buffer are
+  // uploaded together, from the first of them on
+  size_t first_changed = (size_t)-1;
+
+  for (size_t quad : erased_slots)
+  {
+    size_t last = centers_.size() - 1;
+    if (quad != last)
+    {
+      std::copy(vertices_.begin() + 4 * last, vertices_.begin() + 4 * (last + 1), vertices_.begin() + 4 * quad);
+      centers_[quad] = centers_[last];
+      first_changed = std::min(first_changed, quad);
+    }
+
+    vertices_.resize(4 * last);
+    centers_.pop_back();
+  }
+
+  version_ = points.getVersion();
+
+  if (first_changed < centers_.size())
+    Upload(first_changed, centers_.size() - first_changed);
+}
+
+
+void PointRenderer::Move(const PointStore& points, const std::vector<PointId>& ids)
+{
+  size_t first = (size_t)-1, last = 0;
+
+  for (PointId id : ids)
+  {
+    size_t slot = points.FindSlot(id);
+    if (slot == (size_t)-1)
+      continue;
+
+    centers_[slot] = { points.x(slot), points.y(slot) };
+    SetQuad(slot);
+
+    first = std::min(first, slot);
+    last = std::max(last, slot);
+  }
+
+  version_ = points.getVersion();
+
+  if (first <= last)
+    Upload(first, last - first + 1);
+}
+
+
+size_t PointRenderer::Draw(sf::RenderTarget& target, const SpatialGrid& grid, const sf::FloatRect& view)
+{
+  if (vertices_.empty())
+    return 0;
+
+  sf::RenderStates states(&texture_);
+
+  float half = radius_ * (1.0f + outline_proportion_);
+  if (shader_available_)
+  {
+    shader_.setUniform("half_size", half);
+    states.shader = &shader_;
+  }
+  float min_x = view.left - half, min_y = view.top - half;
+  float max_x = view.left + view.width + half, max_y = view.top + view.height + half;
+
+  if (grid.size() != getCount() || isFullDrawCheaper(grid.getCoverage(min_x, min_y, max_x, max_y)))
+  {
+    if (buffer_available_)
+      target.draw(buffer_, 0, vertices_.size(), states);
+    else
+      target.draw(vertices_.data(), vertices_.size(), sf::Quads, states);
+
+    return getCount();
+  }
+
+  if (view != culled_view_ || version_ != culled_version_ || radius_ != culled_radius_)
+  {
+    culled_view_ = view;
+    culled_version_ = version_;
+    culled_radius_ = radius_;
+
+    culled_.clear();
+    grid.QueryRect(min_x, min_y, max_x, max_y, 
+                   [this](const GridEntry& e)
+                   {
+                     culled_.resize(culled_.size() + 4);
+                     WriteQuad(&culled_[culled_.size() - 4], e.x, e.y);
+                   });
+  }
+
+  if (!culled_.empty())
+    target.draw(culled_.data(), culled_.size(), sf::Quads, states);
+
+  return culled_.size() / 4;
+}
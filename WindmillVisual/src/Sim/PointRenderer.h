@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include <SFML/Graphics.hpp>
+
+#include "PointStore.h"
+#include "SpatialGrid.h"
+
+// Every point as a textured ring quad, kept in a static vertex buffer on the
+// GPU. Adding, deleting or moving points only uploads the quads that
+// changed; all of them are rebuilt only when the store was changed behind
+// the renderer's back. The four corners of a quad all sit on the point and
+// a vertex shader spreads them out by the radius, so zooming leaves the
+// buffer alone; without shaders the quads are rebuilt for a new radius.
+// When only a small part of the scene is in view, just the visible points
+// are looked up in the grid and drawn.
+class PointRenderer
+{
+private:
+
+  static const float outline_proportion_;
+  static const unsigned texture_size_;
+  static const char* vertex_shader_;
+  static const char* fragment_shader_;
+
+  sf::Texture texture_;
+
+  sf::Shader shader_;
+  bool shader_available_;
+
+  // quads by slot: a removal moves the last quad into the hole just as the
+  // store moved its last point, so the two keep the same order
+  std::vector<sf::Vertex> vertices_;
+  std::vector<sf::Vector2f> centers_;
+
+  sf::VertexBuffer buffer_;
+  bool buffer_available_;
+
+  uint64_t version_;
+  float radius_;
+
+  // the visible points' quads, kept while the view and points stay put
+  std::vector<sf::Vertex> culled_;
+  sf::FloatRect culled_view_;
+  uint64_t culled_version_;
+  float culled_radius_;
+
+  void CreateTexture();
+
+  void WriteQuad(sf::Vertex* v, float x, float y) const;
+
+  void SetQuad(size_t quad);
+
+  void Rebuild(const PointStore& points);
+
+  void Rescale();
+
+  void Upload(size_t first_quad, size_t quad_count);
+
+public:
+
+  PointRenderer();
+
+  // Whether the quads match the store, so the next change can be patched in
+  bool isInSync(const PointStore& points) const;
+
+  // Rebuilds everything if the store or radius changed
+  void Sync(const PointStore& points, float radius);
+
+  // Patch in the points just added to the store from first_slot on, when it
+  // was in sync before. Their quads are uploaded in one go
+  void Add(const PointStore& points, size_t first_slot);
+
+  // Patch out points just erased from the store, when it was in sync before,
+  // given the slot each was erased from in the order they went. The quads
+  // that fill the holes are uploaded in one go
+  void Remove(const PointStore& points, const std::vector<size_t>& erased_slots);
+
+  // Patch in the new positions of points just moved in the store, uploading
+  // the span of quads they cover in one go
+  void Move(const PointStore& points, const std::vector<PointId>& ids);
+
+  // Returns the number of points drawn
+  size_t Draw(sf::RenderTarget& target, const SpatialGrid& grid, const sf::FloatRect& view);
+
+  size_t getCount() const { return centers_.size(); }
+
+};
@@ -0,0 +1,232 @@
+#include "PointScene.h"
+
+#include <algorithm>
+
+#include "Trace.h"
+
+
+// a batch changing more of the points than this rebuilds the grid and the
+// pyramid once rather than updating them point by point
+const size_t PointScene::reindex_percent_ = 25u;
+
+
+PointScene::PointScene()
+  : points_()
+  , grid_()
+  , density_()
+{
+}
+
+
+void PointScene::AddPoints(const Vec2* positions, size_t count)
+{
+  TRACE_SCOPE("PointScene::AddPoints");
+
+  bool density_stale = false;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    PointId id = points_.Add(positions[i].x, positions[i].y);
+    grid_.Insert(positions[i].x, positions[i].y, id);
+
+    // once the pyramid has to be reset, it is rebuilt once at the end
+    if (!density_stale && !density_.Insert(positions[i].x, positions[i].y))
+      density_stale = true;
+  }
+
+  if (density_stale)
+    RebuildDensity();
+}
+
+
+void PointScene::AddPoints(const std::vector<Vec2>& positions)
+{
+  AddPoints(positions.data(), positions.size());
+}
+
+
+void PointScene::DeletePoints(const PointId* ids, size_t count, std::vector<size_t>& erased_slots)
+{
+  TRACE_SCOPE("PointScene::DeletePoints");
+
+  bool reindex = count * 100 > points_.size() * reindex_percent_;
+  erased_slots.clear();
+
+  for (size_t i = 0; i < count; i++)
+  {
+    size_t slot = points_.FindSlot(ids[i]);
+    if (slot == (size_t)(-1))
+      continue;
+
+    if (!reindex)
+    {
+      grid_.Remove(points_.x(slot), points_.y(slot), ids[i]);
+      density_.Remove(points_.x(slot), points_.y(slot));
+    }
+    points_.Erase(slot);
+    erased_slots.push_back(slot);
+  }
+
+  if (!erased_slots.empty() && reindex)
+    RebuildIndices();
+}
+
+
+void PointScene::DeletePoints(const std::vector<PointId>& ids, std::vector<size_t>& erased_slots)
+{
+  DeletePoints(ids.data(), ids.size(), erased_slots);
+}
+
+
+void PointScene::TransformPoints(const std::vector<PointId>& ids, const Transform2& transform)
+{
+  TRACE_SCOPE("PointScene::TransformPoints");
+
+  bool reindex = ids.size() * 100 > points_.size() * reindex_percent_;
+  bool density_stale = false;
+  bool any = false;
+
+  for (PointId id : ids)
+  {
+    size_t slot = points_.FindSlot(id);
+    if (slot == (size_t)(-1))
+      continue;
+
+    Vec2 from = { points_.x(slot), points_.y(slot) };
+    Vec2 to = transform.Apply(from);
+
+    if (!reindex)
+    {
+      grid_.Remove(from.x, from.y, id);
+      grid_.Insert(to.x, to.y, id);
+
+      density_.Remove(from.x, from.y);
+      if (!density_stale && !density_.Insert(to.x, to.y))
+        density_stale = true;
+    }
+    points_.setPosition(slot, to.x, to.y);
+    any = true;
+  }
+
+  if (!any)
+    return;
+
+  if (reindex)
+    RebuildIndices();
+  else if (density_stale)
+    RebuildDensity();
+}
+
+
+void PointScene::Clear()
+{
+  points_.Clear();
+  grid_.Clear();
+  density_.Clear();
+}
+
+
+void PointScene::RebuildDensity()
+{
+  TRACE_SCOPE("PointScene::RebuildDensity");
+
+  float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+  for (size_t i = 0; i < points_.size(); i++)
+  {
+    min_x = std::min(min_x, points_.x(i));
+    min_y = std::min(min_y, points_.y(i));
+    max_x = std::max(max_x, points_.x(i));
+    max_y = std::max(max_y, points_.y(i));
+  }
+
+  density_.Reset(min_x, min_y, max_x, max_y, points_.size());
+  for (size_t i = 0; i < points_.size(); i++)
+    density_.Insert(points_.x(i), points_.y(i));
+}
+
+
+void PointScene::RebuildIndices()
+{
+  TRACE_SCOPE("PointScene::RebuildIndices");
+
+  if (points_.empty())
+  {
+    grid_.Clear();
+    density_.Clear();
+    return;
+  }
+
+  grid_.Assign(points_.xs(), points_.ys(), points_.ids(), points_.size());
+  RebuildDensity();
+}
+
+
+size_t PointScene::FindPoint(Vec2 pos, float radius) const
+{
+  GridEntry nearest;
+  if (!grid_.FindNearest(pos.x, pos.y, radius, nearest))
+    return (size_t)(-1);
+
+  return points_.FindSlot(nearest.id);
+}
+
+
+void PointScene::FindPointsInRect(Vec2 min, Vec2 max, std::vector<PointId>& ids) const
+{
+  grid_.QueryRect(min.x, min.y, max.x, max.y, [&](const GridEntry& e)
+                  {
+                    ids.push_back(e.id);
+                  });
+}
+
+
+void PointScene::FindPointsInPolygon(const std::vector<Vec2>& polygon, std::vector<PointId>& ids) const
+{
+  if (polygon.size() < 3)
+    return;
+
+  Vec2 min = polygon[0], max = polygon[0];
+  for (const Vec2& v : polygon)
+  {
+    min.x = std::min(min.x, v.x);
+    min.y = std::min(min.y, v.y);
+    max.x = std::max(max.x, v.x);
+    max.y = std::max(max.y, v.y);
+  }
+
+  // the grid narrows it down to the bounding box, then a ray cast to the
+  // right decides: inside when it crosses the outline an odd number of times
+  grid_.QueryRect(min.x, min.y, max.x, max.y, [&](const GridEntry& e)
+                  {
+                    bool inside = false;
+                    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+                    {
+                      const Vec2& a = polygon[i];
+                      const Vec2& b = polygon[j];
+                      if ((a.y > e.y) != (b.y > e.y) &&
+                          e.x < a.x + (b.x - a.x) * (e.y - a.y) / (b.y - a.y))
+                        inside = !inside;
+                    }
+
+                    if (inside)
+                      ids.push_back(e.id);
+                  });
+}
+
+
+const PointStore& PointScene::getPoints() const
+{
+  return points_;
+}
+
+
+const SpatialGrid& PointScene::getGrid() const
+{
+  return grid_;
+}
+
+
+const DensityPyramid& PointScene::getDensity() const
+{
+  return density_;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include "Vec2.h"
+#include "PointStore.h"
+#include "SpatialGrid.h"
+#include "DensityPyramid.h"
+
+// Points with what it takes to pick and draw them: a grid to find them by
+// position and a pyramid to count them by area. The simulation needs
+// neither, so only the side that edits and draws the points keeps a scene;
+// its store sees the same adds and erases as the simulation's, so both give
+// out the same ids.
+class PointScene
+{
+private:
+
+  static const size_t reindex_percent_;
+
+  PointStore points_;
+  SpatialGrid grid_;
+  DensityPyramid density_;
+
+  void RebuildDensity();
+
+  void RebuildIndices();
+
+public:
+
+  PointScene();
+
+  // They take the last count slots
+  void AddPoints(const Vec2* positions, size_t count);
+
+  void AddPoints(const std::vector<Vec2>& positions);
+
+  // Stale ids are skipped. Sets erased_slots to the slot each point had as
+  // it was erased, in order, for anything kept in slot order to follow
+  void DeletePoints(const PointId* ids, size_t count, std::vector<size_t>& erased_slots);
+
+  void DeletePoints(const std::vector<PointId>& ids, std::vector<size_t>& erased_slots);
+
+  // Each id once. They keep their slots and ids
+  void TransformPoints(const std::vector<PointId>& ids, const Transform2& transform);
+
+  void Clear();
+
+  // Returns (size_t)-1 when no point is within the radius
+  size_t FindPoint(Vec2 pos, float radius) const;
+
+  // Appends the ids of the points inside the rectangle
+  void FindPointsInRect(Vec2 min, Vec2 max, std::vector<PointId>& ids) const;
+
+  // Appends the ids of the points inside the polygon, which may cross itself
+  void FindPointsInPolygon(const std::vector<Vec2>& polygon, std::vector<PointId>& ids) const;
+
+  const PointStore& getPoints() const;
+
+  const SpatialGrid& getGrid() const;
+
+  const DensityPyramid& getDensity() const;
+
+};
@@ -0,0 +1,182 @@
+#include "PointStore.h"
+
+#include <math.h>
+#include <stdexcept>
+
+#include "SideKernel.h"
+
+
+// the rest of an id is the entry's generation, which takes 2^32 reuses of
+// one entry to come round again
+const unsigned PointStore::entry_bits_ = 32u;
+
+const uint32_t PointStore::no_entry_ = (uint32_t)(-1);
+
+const PointId PointStore::no_id_ = (PointId)(-1);
+
+// entries go up to no_entry_, which is left out, so no_id_ can't name one
+const size_t PointStore::max_size_ = no_entry_;
+
+
+PointStore::PointStore()
+  : free_entry_(no_entry_)
+  , version_(0)
+{
+}
+
+
+PointId PointStore::Add(float x, float y)
+{
+  if (xs_.size() >= max_size_)
+    throw std::length_error("PointStore: too many points");
+
+  version_++;
+
+  uint32_t entry = free_entry_;
+  if (entry != no_entry_)
+  {
+    free_entry_ = entries_[entry];
+  }
+  else
+  {
+    entry = (uint32_t)entries_.size();
+    entries_.push_back(0u);
+    generations_.push_back(0u);
+  }
+
+  PointId id = ((PointId)generations_[entry] << entry_bits_) | entry;
+  entries_[entry] = (uint32_t)xs_.size();
+
+  xs_.push_back(x);
+  ys_.push_back(y);
+  ids_.push_back(id);
+
+  if (sides_.size() * 64 < xs_.size())
+  {
+    sides_.push_back(0u);
+    changed_.push_back(0u);
+  }
+
+  return id;
+}
+
+
+void PointStore::Erase(size_t slot)
+{
+  version_++;
+
+  size_t last = xs_.size() - 1;
+
+  // ids of the erased point go stale, and its entry is the next handed out
+  uint32_t entry = (uint32_t)ids_[slot];
+  generations_[entry]++;
+  entries_[entry] = free_entry_;
+  free_entry_ = entry;
+
+  if (slot != last)
+  {
+    xs_[slot] = xs_[last];
+    ys_[slot] = ys_[last];
+    ids_[slot] = ids_[last];
+    entries_[(uint32_t)ids_[slot]] = (uint32_t)slot;
+
+    MoveBit(sides_, last, slot);
+    MoveBit(changed_, last, slot);
+  }
+
+  xs_.pop_back();
+  ys_.pop_back();
+  ids_.pop_back();
+
+  // the last point's bits are no longer part of the set
+  sides_[last / 64] &= ~(uint64_t(1) << (last % 64));
+  changed_[last / 64] &= ~(uint64_t(1) << (last % 64));
+
+  if (sides_.size() * 64 >= xs_.size() + 64)
+  {
+    sides_.pop_back();
+    changed_.pop_back();
+  }
+}
+
+
+void PointStore::setPosition(size_t slot, float x, float y)
+{
+  version_++;
+
+  xs_[slot] = x;
+  ys_[slot] = y;
+}
+
+
+void PointStore::MoveBit(std::vector<uint64_t>& words, size_t from, size_t to)
+{
+  uint64_t bit = (words[from / 64] >> (from % 64)) & 1u;
+
+  words[to / 64] = (words[to / 64] & ~(uint64_t(1) << (to % 64))) | (bit << (to % 64));
+}
+
+
+void PointStore::Clear()
+{
+  version_++;
+
+  // every live id goes stale as if erased, so one still held somewhere can't
+  // name a later point; the entries are handed out again in order, so
+  // stores cleared alike still agree on ids
+  for (PointId id : ids_)
+    generations_[(uint32_t)id]++;
+
+  for (size_t entry = 0; entry < entries_.size(); entry++)
+    entries_[entry] = entry + 1 < entries_.size() ? (uint32_t)(entry + 1) : no_entry_;
+  free_entry_ = entries_.empty() ? no_entry_ : 0u;
+
+  xs_.clear();
+  ys_.clear();
+  ids_.clear();
+  sides_.clear();
+  changed_.clear();
+}
+
+
+size_t PointStore::getMemoryUsed() const
+{
+  return xs_.capacity() * sizeof(float) + 
+         ys_.capacity() * sizeof(float) + 
+         ids_.capacity() * sizeof(PointId) + 
+         entries_.capacity() * sizeof(uint32_t) + 
+         generations_.capacity() * sizeof(uint32_t) + 
+         sides_.capacity() * sizeof(uint64_t) + 
+         changed_.capacity() * sizeof(uint64_t);
+}
+
+
+void PointStore::ClassifySides(float px, float py, double rad)
+{
+  ::ClassifySides(xs_.data(), ys_.data(), xs_.size(), px, py, 
+                  (float)std::cos(rad), (float)std::sin(rad),
+                  sides_.data(), changed_.data());
+}
+
+
+bool PointStore::getSide(size_t slot) const
+{
+  return (sides_[slot / 64] >> (slot % 64)) & 1u;
+}
+
+
+void PointStore::setSide(size_t slot, bool on_clockwise)
+{
+  uint64_t bit = uint64_t(1) << (slot % 64);
+
+  if (on_clockwise)
+    sides_[slot / 64] |= bit;
+  else
+    sides_[slot / 64] &= ~bit;
+}
+
+
+void PointStore::clearChanged(size_t slot)
+{
+  changed_[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+}
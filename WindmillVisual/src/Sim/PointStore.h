@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// Names a point for as long as it lives: the entry holding its slot in the
+// low 32 bits, the entry's generation in the high 32
+typedef uint64_t PointId;
+
+// Points kept as contiguous coordinate arrays, with the side of the line each
+// point is on packed one bit per point. Erasing moves the last point into the
+// freed slot, so slots change; a point's id does not. Ids are handles into a
+// table of entries holding each point's slot, tagged with a generation that
+// changes whenever an entry is freed, so an id of an erased point is never
+// mistaken for a later point's. Entries are handed out in a fixed order, so
+// stores that see the same adds and erases give out the same ids.
+class PointStore
+{
+private:
+
+  static const unsigned entry_bits_;
+  static const uint32_t no_entry_;
+
+  std::vector<float> xs_;
+  std::vector<float> ys_;
+  std::vector<PointId> ids_;
+
+  // by entry: the point's slot while it lives, the next free entry after
+  std::vector<uint32_t> entries_;
+  std::vector<uint32_t> generations_;
+  uint32_t free_entry_;
+
+  std::vector<uint64_t> sides_;
+  std::vector<uint64_t> changed_;
+
+  uint64_t version_;
+
+  static void MoveBit(std::vector<uint64_t>& words, size_t from, size_t to);
+
+public:
+
+  // never the id of a point
+  static const PointId no_id_;
+
+  // more than this many points at once can't be told apart
+  static const size_t max_size_;
+
+  PointStore();
+
+  size_t size() const { return xs_.size(); }
+  bool empty() const { return xs_.empty(); }
+
+  float x(size_t slot) const { return xs_[slot]; }
+  float y(size_t slot) const { return ys_[slot]; }
+  PointId id(size_t slot) const { return ids_[slot]; }
+
+  const float* xs() const { return xs_.data(); }
+  const float* ys() const { return ys_.data(); }
+  const PointId* ids() const { return ids_.data(); }
+
+  // Returns the new point's id. Throws std::length_error past max_size_
+  PointId Add(float x, float y);
+
+  // Moves the last point into the slot, so every other point keeps its slot
+  void Erase(size_t slot);
+
+  // The point keeps its slot and id
+  void setPosition(size_t slot, float x, float y);
+
+  // Erases every point. Their ids stay stale, as after Erase
+  void Clear();
+
+  // Returns (size_t)-1 for an id whose point was erased
+  size_t FindSlot(PointId id) const
+  {
+    uint32_t entry = (uint32_t)id;
+    if (entry >= entries_.size() || generations_[entry] != (uint32_t)(id >> entry_bits_))
+      return (size_t)(-1);
+
+    return entries_[entry];
+  }
+
+  // Reclassifies every point against the line through (px, py) at angle rad and
+  // records which points changed side since the last classification
+  void ClassifySides(float px, float py, double rad);
+
+  bool getSide(size_t slot) const;
+  void setSide(size_t slot, bool on_clockwise);
+
+  const std::vector<uint64_t>& getChanged() const { return changed_; }
+  void clearChanged(size_t slot);
+
+  size_t getMemoryUsed() const;
+
+  // Changes whenever points are added, moved, erased or cleared
+  uint64_t getVersion() const { return version_; }
+
+};
@@ -0,0 +1,179 @@
+#include "SegmentGrid.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include "Coverage.h"
+
+
+const int SegmentGrid::resolution_ = 128;
+
+
+SegmentGrid::SegmentGrid()
+  : min_x_(0.0f)
+  , min_y_(0.0f)
+  , cell_w_(1.0f)
+  , cell_h_(1.0f)
+  , built_(false)
+  , seg_min_x_(INFINITY)
+  , seg_min_y_(INFINITY)
+  , seg_max_x_(-INFINITY)
+  , seg_max_y_(-INFINITY)
+  , stamp_(0)
+{
+}
+
+
+bool SegmentGrid::isInside(const std::array<float, 4>& s) const
+{
+  float max_x = min_x_ + resolution_ * cell_w_;
+  float max_y = min_y_ + resolution_ * cell_h_;
+
+  return std::min(s[0], s[2]) >= min_x_ && std::max(s[0], s[2]) < max_x &&
+         std::min(s[1], s[3]) >= min_y_ && std::max(s[1], s[3]) < max_y;
+}
+
+
+int SegmentGrid::getCellX(float x) const
+{
+  return std::min(std::max((int)std::floor((x - min_x_) / cell_w_), 0), resolution_ - 1);
+}
+
+
+int SegmentGrid::getCellY(float y) const
+{
+  return std::min(std::max((int)std::floor((y - min_y_) / cell_h_), 0), resolution_ - 1);
+}
+
+
+void SegmentGrid::Rebuild()
+{
+  float min_x = seg_min_x_, min_y = seg_min_y_, max_x = seg_max_x_, max_y = seg_max_y_;
+
+  // half the size again on every side, so later segments rarely fall outside
+  float margin_x = std::max((max_x - min_x) / 2.0f, 1.0f);
+  float margin_y = std::max((max_y - min_y) / 2.0f, 1.0f);
+  min_x_ = min_x - margin_x;
+  min_y_ = min_y - margin_y;
+  cell_w_ = (max_x - min_x + 2 * margin_x) / resolution_;
+  cell_h_ = (max_y - min_y + 2 * margin_y) / resolution_;
+  built_ = true;
+
+  cells_.assign(resolution_ * resolution_, std::vector<unsigned>());
+  for (unsigned i = 0; i < segments_.size(); i++)
+    InsertCells(i);
+}
+
+
+void SegmentGrid::InsertCells(unsigned index)
+{
+  const auto& s = segments_[index];
+
+  // walks the cells the segment passes through, one cell boundary at a time
+  float x0 = (s[0] - min_x_) / cell_w_, y0 = (s[1] - min_y_) / cell_h_;
+  float x1 = (s[2] - min_x_) / cell_w_, y1 = (s[3] - min_y_) / cell_h_;
+
+  int cx = getCellX(s[0]), cy = getCellY(s[1]);
+  int end_x = getCellX(s[2]), end_y = getCellY(s[3]);
+
+  float dx = x1 - x0, dy = y1 - y0;
+  int step_x = dx > 0 ? 1 : -1, step_y = dy > 0 ? 1 : -1;
+
+  float t_delta_x = dx != 0.0f ? fabsf(1.0f / dx) : INFINITY;
+  float t_delta_y = dy != 0.0f ? fabsf(1.0f / dy) : INFINITY;
+  float t_max_x = dx != 0.0f ? ((dx > 0 ? cx + 1 - x0 : x0 - cx) * t_delta_x) : INFINITY;
+  float t_max_y = dy != 0.0f ? ((dy > 0 ? cy + 1 - y0 : y0 - cy) * t_delta_y) : INFINITY;
+
+  // bounded, so rounding can't walk past the end cell forever
+  int steps = std::abs(end_x - cx) + std::abs(end_y - cy);
+  for (int i = 0; ; i++)
+  {
+    cells_[cy * resolution_ + cx].push_back(index);
+
+    if (i >= steps || (cx == end_x && cy == end_y))
+      break;
+
+    if (t_max_x < t_max_y)
+    {
+      cx = std::min(std::max(cx + step_x, 0), resolution_ - 1);
+      t_max_x += t_delta_x;
+    }
+    else
+    {
+      cy = std::min(std::max(cy + step_y, 0), resolution_ - 1);
+      t_max_y += t_delta_y;
+    }
+  }
+}
+
+
+void SegmentGrid::Add(float x0, float y0, float x1, float y1)
+{
+  segments_.push_back({ x0, y0, x1, y1 });
+  seen_.push_back(0u);
+
+  seg_min_x_ = std::min({ seg_min_x_, x0, x1 });
+  seg_min_y_ = std::min({ seg_min_y_, y0, y1 });
+  seg_max_x_ = std::max({ seg_max_x_, x0, x1 });
+  seg_max_y_ = std::max({ seg_max_y_, y0, y1 });
+
+  if (!built_ || !isInside(segments_.back()))
+    Rebuild();
+  else
+    InsertCells((unsigned)segments_.size() - 1);
+}
+
+
+void SegmentGrid::Clear()
+{
+  segments_.clear();
+  seen_.clear();
+  cells_.clear();
+  built_ = false;
+
+  seg_min_x_ = seg_min_y_ = INFINITY;
+  seg_max_x_ = seg_max_y_ = -INFINITY;
+}
+
+
+void SegmentGrid::Query(float min_x, float min_y, float max_x, float max_y, std::vector<unsigned>& indices) const
+{
+  indices.clear();
+  if (!built_ || min_x > max_x || min_y > max_y)
+    return;
+
+  if (++stamp_ == 0)
+  {
+    std::fill(seen_.begin(), seen_.end(), 0u);
+    stamp_ = 1;
+  }
+
+  int cx0 = getCellX(min_x), cx1 = getCellX(max_x);
+  int cy0 = getCellY(min_y), cy1 = getCellY(max_y);
+
+  for (int cy = cy0; cy <= cy1; cy++)
+  {
+    for (int cx = cx0; cx <= cx1; cx++)
+    {
+      for (unsigned i : cells_[cy * resolution_ + cx])
+      {
+        if (seen_[i] != stamp_)
+        {
+          seen_[i] = stamp_;
+          indices.push_back(i);
+        }
+      }
+    }
+  }
+
+  std::sort(indices.begin(), indices.end());
+}
+
+
+float SegmentGrid::getCoverage(float min_x, float min_y, float max_x, float max_y) const
+{
+  if (segments_.empty())
+    return 0.0f;
+
+  return getBoxCoverage(seg_min_x_, seg_min_y_, seg_max_x_, seg_max_y_, min_x, min_y, max_x, max_y);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <stddef.h>
+
+// Line segments indexed by the cells of a fixed resolution grid they pass
+// through. Segments are only ever appended; the grid is laid over their
+// bounding box and rebuilt, with room to spare, when one falls outside it.
+class SegmentGrid
+{
+private:
+
+  static const int resolution_;
+
+  std::vector<std::array<float, 4>> segments_;
+
+  std::vector<std::vector<unsigned>> cells_;
+  float min_x_, min_y_;
+  float cell_w_, cell_h_;
+  bool built_;
+
+  // bounding box of the segments themselves
+  float seg_min_x_, seg_min_y_, seg_max_x_, seg_max_y_;
+
+  // query stamp of each segment, to report it once
+  mutable std::vector<unsigned> seen_;
+  mutable unsigned stamp_;
+
+  bool isInside(const std::array<float, 4>& s) const;
+
+  void Rebuild();
+
+  void InsertCells(unsigned index);
+
+  int getCellX(float x) const;
+  int getCellY(float y) const;
+
+public:
+
+  SegmentGrid();
+
+  size_t size() const { return segments_.size(); }
+
+  void Add(float x0, float y0, float x1, float y1);
+
+  void Clear();
+
+  // Indices of the segments passing through cells that touch the rectangle,
+  // in the order they were added
+  void Query(float min_x, float min_y, float max_x, float max_y, std::vector<unsigned>& indices) const;
+
+  // Fraction of the segments' bounding box inside the rectangle
+  float getCoverage(float min_x, float min_y, float max_x, float max_y) const;
+
+};
@@ -0,0 +1,173 @@
+#include "SideKernel.h"
+
+// The AVX kernel is built either because the whole build targets AVX, or,
+// with GCC and Clang on x86, as a separately targeted function picked at
+// run time when the CPU has it
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIDE_KERNEL_AVX
+#define SIDE_KERNEL_AVX_TARGET
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SIDE_KERNEL_AVX
+#define SIDE_KERNEL_AVX_TARGET __attribute__((target("avx")))
+#define SIDE_KERNEL_DISPATCH
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIDE_KERNEL_SSE2
+#endif
+
+
+static inline uint64_t ClassifyScalar(const float* xs, const float* ys, size_t count,
+                                      float px, float py, float dir_x, float dir_y)
+{
+  uint64_t bits = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    float cross = dir_y * (xs[i] - px) - dir_x * (ys[i] - py);
+    bits |= (uint64_t)(cross > 0.0f) << i;
+  }
+  return bits;
+}
+
+
+#if defined(SIDE_KERNEL_AVX)
+
+SIDE_KERNEL_AVX_TARGET
+static inline uint64_t ClassifyWordAvx(const float* xs, const float* ys,
+                                       float px, float py, float dir_x, float dir_y)
+{
+  const __m256 vpx = _mm256_set1_ps(px);
+  const __m256 vpy = _mm256_set1_ps(py);
+  const __m256 vdx = _mm256_set1_ps(dir_x);
+  const __m256 vdy = _mm256_set1_ps(dir_y);
+  const __m256 zero = _mm256_setzero_ps();
+
+  uint64_t bits = 0;
+  for (unsigned i = 0; i < 64; i += 8)
+  {
+    __m256 rx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), vpx);
+    __m256 ry = _mm256_sub_ps(_mm256_loadu_ps(ys + i), vpy);
+    __m256 cross = _mm256_sub_ps(_mm256_mul_ps(vdy, rx), _mm256_mul_ps(vdx, ry));
+
+    bits |= (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(cross, zero, _CMP_GT_OQ)) << i;
+  }
+  return bits;
+}
+
+
+SIDE_KERNEL_AVX_TARGET
+static void ClassifyWordsAvx(const float* xs, const float* ys, size_t words,
+                             float px, float py, float dir_x, float dir_y,
+                             uint64_t* sides, uint64_t* changed)
+{
+  for (size_t w = 0; w < words; w++)
+  {
+    uint64_t bits = ClassifyWordAvx(xs + w * 64, ys + w * 64, px, py, dir_x, dir_y);
+
+    changed[w] = bits ^ sides[w];
+    sides[w] = bits;
+  }
+}
+
+#endif
+
+
+#if defined(SIDE_KERNEL_SSE2)
+
+static inline uint64_t ClassifyWord(const float* xs, const float* ys,
+                                    float px, float py, float dir_x, float dir_y)
+{
+  const __m128 vpx = _mm_set1_ps(px);
+  const __m128 vpy = _mm_set1_ps(py);
+  const __m128 vdx = _mm_set1_ps(dir_x);
+  const __m128 vdy = _mm_set1_ps(dir_y);
+  const __m128 zero = _mm_setzero_ps();
+
+  uint64_t bits = 0;
+  for (unsigned i = 0; i < 64; i += 4)
+  {
+    __m128 rx = _mm_sub_ps(_mm_loadu_ps(xs + i), vpx);
+    __m128 ry = _mm_sub_ps(_mm_loadu_ps(ys + i), vpy);
+    __m128 cross = _mm_sub_ps(_mm_mul_ps(vdy, rx), _mm_mul_ps(vdx, ry));
+
+    bits |= (uint64_t)_mm_movemask_ps(_mm_cmpgt_ps(cross, zero)) << i;
+  }
+  return bits;
+}
+
+#else
+
+static inline uint64_t ClassifyWord(const float* xs, const float* ys,
+                                    float px, float py, float dir_x, float dir_y)
+{
+  return ClassifyScalar(xs, ys, 64, px, py, dir_x, dir_y);
+}
+
+#endif
+
+
+static void ClassifyWords(const float* xs, const float* ys, size_t words,
+                          float px, float py, float dir_x, float dir_y,
+                          uint64_t* sides, uint64_t* changed)
+{
+  for (size_t w = 0; w < words; w++)
+  {
+    uint64_t bits = ClassifyWord(xs + w * 64, ys + w * 64, px, py, dir_x, dir_y);
+
+    changed[w] = bits ^ sides[w];
+    sides[w] = bits;
+  }
+}
+
+
+static bool hasAvx()
+{
+#if defined(SIDE_KERNEL_DISPATCH)
+  static const bool avx = __builtin_cpu_supports("avx");
+  return avx;
+#elif defined(SIDE_KERNEL_AVX)
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+void ClassifySides(const float* xs, const float* ys, size_t count,
+                   float px, float py, float dir_x, float dir_y,
+                   uint64_t* sides, uint64_t* changed)
+{
+  size_t full_words = count / 64;
+
+#if defined(SIDE_KERNEL_AVX)
+  if (hasAvx())
+    ClassifyWordsAvx(xs, ys, full_words, px, py, dir_x, dir_y, sides, changed);
+  else
+#endif
+    ClassifyWords(xs, ys, full_words, px, py, dir_x, dir_y, sides, changed);
+
+  // tail that does not fill a whole word
+  if (count % 64)
+  {
+    uint64_t bits = ClassifyScalar(xs + full_words * 64, ys + full_words * 64, count % 64,
+                                   px, py, dir_x, dir_y);
+
+    changed[full_words] = bits ^ sides[full_words];
+    sides[full_words] = bits;
+  }
+}
+
+
+const char* getSideKernelName()
+{
+  if (hasAvx())
+    return "avx";
+#if defined(SIDE_KERNEL_SSE2)
+  return "sse2";
+#else
+  return "scalar";
+#endif
+}
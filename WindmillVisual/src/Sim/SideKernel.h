@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Classifies points against the directed line through (px, py) with direction
+// (dir_x, dir_y). Bit i of sides is set when point i is on the clockwise side,
+// i.e. dir_y * (x - px) - dir_x * (y - py) > 0. The previous bits in sides are
+// replaced, and changed receives the bits that flipped. Both arrays hold
+// (count + 63) / 64 words; bits past count are cleared.
+void ClassifySides(const float* xs, const float* ys, size_t count,
+                   float px, float py, float dir_x, float dir_y,
+                   uint64_t* sides, uint64_t* changed);
+
+// Name of the instruction set the kernel runs with on this CPU
+const char* getSideKernelName();
+
+// Index of the lowest set bit, bits must not be zero
+inline unsigned CountTrailingZeros(uint64_t bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long i;
+  _BitScanForward64(&i, bits);
+  return (unsigned)i;
+#elif defined(_MSC_VER)
+  unsigned long i;
+  if (_BitScanForward(&i, (unsigned long)bits))
+    return (unsigned)i;
+  _BitScanForward(&i, (unsigned long)(bits >> 32));
+  return (unsigned)i + 32;
+#else
+  return (unsigned)__builtin_ctzll(bits);
+#endif
+}
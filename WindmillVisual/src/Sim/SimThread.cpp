@@ -0,0 +1,328 @@
+#include "SimThread.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Trace.h"
+
+
+const double SimThread::tick_seconds_ = 1.0 / 240.0;
+
+// a thread that fell further behind than this drops the time instead
+const unsigned SimThread::max_ticks_per_wake_ = 8u;
+
+const size_t SimThread::command_capacity_ = 1u << 14;
+
+// more than the renderer could ever show at once
+const size_t SimThread::max_pending_switches_ = 4096u;
+
+const size_t SimThread::max_published_ = 1024u;
+
+
+SimThread::SimThread()
+  : sim_()
+  , commands_(command_capacity_)
+  , snapshots_()
+  , running_(true)
+  , built_version_(0)
+  , table_ready_(false)
+  , sequence_(0)
+  , commands_applied_(0)
+  , switch_total_(0)
+  , acknowledged_(0)
+  , commands_pushed_(0)
+{
+  thread_ = std::thread(&SimThread::Run, this);
+}
+
+
+SimThread::~SimThread()
+{
+  running_ = false;
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_.notify_one();
+
+  thread_.join();
+
+  if (table_builder_.joinable())
+    table_builder_.join();
+}
+
+
+void SimThread::Push(const SimCommand& command)
+{
+  commands_pushed_++;
+
+  while (!commands_.TryPush(command))
+    std::this_thread::yield();
+
+  // taking the lock makes sure the thread is either still about to check
+  // the queue or already waiting to be notified
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+  }
+  wake_.notify_one();
+}
+
+
+bool SimThread::Consume()
+{
+  if (!snapshots_.Consume())
+    return false;
+
+  acknowledged_.store(snapshots_.getFront().sequence, std::memory_order_release);
+  return true;
+}
+
+
+bool SimThread::isBehind() const
+{
+  return getSnapshot().commands_applied < commands_pushed_;
+}
+
+
+void SimThread::Run()
+{
+  typedef std::chrono::steady_clock Clock;
+
+  auto tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(tick_seconds_));
+  Clock::time_point next_tick = Clock::now();
+
+  while (running_)
+  {
+    AdoptTransitions();
+
+    bool changed = ApplyCommands();
+    bool turning = sim_.isStarted() && sim_.isPivotSet() && !sim_.isPaused();
+
+    if (turning)
+    {
+      // fixed steps for the time that has passed
+      Clock::time_point now = Clock::now();
+      for (unsigned t = 0; t < max_ticks_per_wake_ && next_tick <= now; t++)
+      {
+        TRACE_SCOPE("SimThread::Tick");
+
+        sim_.Update(tick_seconds_);
+        next_tick += tick;
+        changed = true;
+
+        const PointStore& points = sim_.getPoints();
+        for (unsigned slot : sim_.getSwitches())
+          pending_switches_.push_back({ { points.x(slot), points.y(slot) }, points.id(slot), sequence_ + 1 });
+        switch_total_ += sim_.getSwitches().size();
+      }
+
+      if (next_tick <= now)
+        next_tick = now + tick;
+
+      while (pending_switches_.size() > max_pending_switches_)
+        pending_switches_.pop_front();
+    }
+
+    if (changed)
+      Publish();
+
+    if (turning)
+    {
+      std::this_thread::sleep_until(next_tick);
+    }
+    else
+    {
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      wake_.wait(lock, [this]()
+                       {
+                         return !running_ || !commands_.isEmpty() || table_ready_;
+                       });
+
+      next_tick = Clock::now();
+    }
+  }
+}
+
+
+bool SimThread::ApplyCommands()
+{
+  bool any = false;
+
+  SimCommand command;
+  while (commands_.TryPop(command))
+  {
+    any = true;
+    commands_applied_++;
+
+    // scrubbing sends a seek per mouse move, only the last of a run matters
+    const SimCommand* next = commands_.Peek();
+    if (command.type == SimCommand::Type::kSeekTo && next && next->type == SimCommand::Type::kSeekTo)
+      continue;
+
+    Apply(command);
+  }
+
+  return any;
+}
+
+
+void SimThread::Apply(const SimCommand& command)
+{
+  TRACE_SCOPE("SimThread::Apply");
+
+  switch (command.type)
+  {
+  case SimCommand::Type::kStart:
+    sim_.Start();
+    break;
+  case SimCommand::Type::kTogglePause:
+    sim_.TogglePause();
+    break;
+  case SimCommand::Type::kRestart:
+    sim_.Restart();
+    pending_switches_.clear();
+    selection_.clear();
+    break;
+  case SimCommand::Type::kAddPoints:
+    sim_.AddPoints(*command.positions);
+    break;
+  case SimCommand::Type::kDeletePoint:
+  {
+    size_t slot = sim_.getPoints().FindSlot(command.id);
+    if (slot != WindmillSim::no_slot_)
+      sim_.DeletePoint(slot);
+    break;
+  }
+  case SimCommand::Type::kChoosePivot:
+  {
+    size_t slot = sim_.getPoints().FindSlot(command.id);
+    if (slot != WindmillSim::no_slot_)
+      sim_.ChoosePivot(slot);
+    break;
+  }
+  case SimCommand::Type::kMultiplyAngularSpeed:
+    sim_.MultiplyAngularSpeed(command.value);
+    break;
+  case SimCommand::Type::kToggleEngine:
+    sim_.toggleEngine();
+    break;
+  case SimCommand::Type::kCompletePath:
+    sim_.CompletePath();
+    break;
+  case SimCommand::Type::kSeekTo:
+    sim_.SeekTo(command.value);
+    pending_switches_.clear();
+    break;
+  case SimCommand::Type::kPrecomputeTransitions:
+    BuildTransitions();
+    break;
+  case SimCommand::Type::kSetSelection:
+    selection_ = *command.ids;
+    break;
+  case SimCommand::Type::kClearSelection:
+    selection_.clear();
+    break;
+  case SimCommand::Type::kDeleteSelection:
+    sim_.DeletePoints(selection_);
+    selection_.clear();
+    break;
+  case SimCommand::Type::kTranslateSelection:
+    sim_.TransformPoints(selection_, Transform2::Translation(command.position));
+    break;
+  case SimCommand::Type::kRotateSelection:
+    sim_.TransformPoints(selection_, Transform2::Rotation(command.position, command.value));
+    break;
+  case SimCommand::Type::kScaleSelection:
+    sim_.TransformPoints(selection_, Transform2::Scaling(command.position, command.value));
+    break;
+  }
+}
+
+
+void SimThread::BuildTransitions()
+{
+  // one build at a time, asking again meanwhile changes nothing
+  if (table_builder_.joinable())
+    return;
+
+  auto points = std::make_shared<PointStore>(sim_.getPoints());
+  built_version_ = points->getVersion();
+  built_table_.reset(new TransitionTable());
+
+  table_builder_ = std::thread([this, points]()
+                               {
+                                 WindmillSim::BuildTransitions(*points, *built_table_);
+
+                                 {
+                                   std::lock_guard<std::mutex> lock(wake_mutex_);
+                                   table_ready_ = true;
+                                 }
+                                 wake_.notify_one();
+                               });
+}
+
+
+void SimThread::AdoptTransitions()
+{
+  if (!table_ready_)
+    return;
+
+  table_builder_.join();
+  table_ready_ = false;
+
+  // points changed during the build leave the table out of date, it's dropped
+  sim_.AdoptTransitions(std::move(*built_table_), built_version_);
+  built_table_.reset();
+}
+
+
+void SimThread::Publish()
+{
+  TRACE_SCOPE("SimThread::Publish");
+
+  uint64_t acknowledged = acknowledged_.load(std::memory_order_acquire);
+
+  // forget what the renderer already has
+  while (!published_.empty() && published_.front().sequence < acknowledged)
+    published_.pop_front();
+  while (!pending_switches_.empty() && pending_switches_.front().sequence <= acknowledged)
+    pending_switches_.pop_front();
+
+  const std::vector<PathEdge>& edges = sim_.getPath().getEdges();
+  uint64_t generation = sim_.getPathGeneration();
+
+  size_t first_edge = 0;
+  if (!published_.empty() && published_.front().sequence == acknowledged &&
+      published_.front().path_generation == generation)
+    first_edge = std::min(published_.front().edge_count, edges.size());
+
+  sequence_++;
+
+  SimSnapshot& snapshot = snapshots_.getBack();
+  snapshot.sequence = sequence_;
+  snapshot.commands_applied = commands_applied_;
+
+  snapshot.started = sim_.isStarted();
+  snapshot.pivot_set = sim_.isPivotSet();
+  snapshot.paused = sim_.isPaused();
+
+  snapshot.pivot_position = sim_.getPivotPosition();
+  snapshot.pivot_id = sim_.isPivotSet() ? sim_.getPivotId() : PointStore::no_id_;
+  snapshot.line_angle = sim_.getLineAngle();
+  snapshot.total_angle = sim_.getTotalAngle();
+
+  snapshot.path_generation = generation;
+  snapshot.points_version = sim_.getPoints().getVersion();
+  snapshot.first_edge = first_edge;
+  snapshot.edges.assign(edges.begin() + first_edge, edges.end());
+
+  snapshot.switches.assign(pending_switches_.begin(), pending_switches_.end());
+  snapshot.switch_total = switch_total_;
+
+  snapshots_.Publish();
+
+  published_.push_back({ sequence_, generation, edges.size() });
+
+  // a renderer that stopped acknowledging just gets everything again
+  if (published_.size() > max_published_)
+    published_.pop_front();
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <stdint.h>
+
+#include "Vec2.h"
+#include "WindmillSim.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+
+// Something the UI asks of the simulation. Points are named by id: the UI's
+// copy of the points sees the same adds and deletes in the same order as the
+// simulation's, so both hand out the same ids. A selection is sent once, as
+// one batch, so deleting or moving it is a single command after that
+struct SimCommand
+{
+  enum class Type
+  {
+    kStart,
+    kTogglePause,
+    kRestart,
+    kAddPoints,
+    kDeletePoint,
+    kChoosePivot,
+    kMultiplyAngularSpeed,
+    kToggleEngine,
+    kCompletePath,
+    kSeekTo,
+    kPrecomputeTransitions,
+    kSetSelection,
+    kClearSelection,
+    kDeleteSelection,
+    kTranslateSelection, // by position
+    kRotateSelection,    // about position by value radians
+    kScaleSelection      // about position by a factor of value
+  };
+
+  Type type;
+  Vec2 position;
+  PointId id;
+  double value;
+
+  // kAddPoints and kSetSelection: the whole batch, shared with the UI
+  // rather than sent one command per element
+  std::shared_ptr<const std::vector<Vec2>> positions;
+  std::shared_ptr<const std::vector<PointId>> ids;
+
+  explicit SimCommand(Type type = Type::kStart, Vec2 position = { 0.0f, 0.0f }, PointId id = 0, double value = 0.0)
+    : type(type)
+    , position(position)
+    , id(id)
+    , value(value)
+    , positions()
+    , ids()
+  {
+  }
+};
+
+struct SnapshotSwitch
+{
+  Vec2 position;
+  PointId id;
+  uint64_t sequence; // of the snapshot that first carried it
+};
+
+// The simulation as the renderer sees it. Path edges and switches come as
+// what's new since the last snapshot the renderer acknowledged, so a
+// snapshot it skipped loses it nothing.
+struct SimSnapshot
+{
+  uint64_t sequence;
+  uint64_t commands_applied;
+
+  bool started;
+  bool pivot_set;
+  bool paused;
+
+  Vec2 pivot_position;
+  PointId pivot_id;
+  double line_angle;
+  double total_angle;
+
+  // the path's edges from index first_edge on; all of them when the
+  // generation differs from the one acknowledged. Their slots are those of
+  // the points at points_version
+  uint64_t path_generation;
+  uint64_t points_version;
+  size_t first_edge;
+  std::vector<PathEdge> edges;
+
+  std::vector<SnapshotSwitch> switches;
+  uint64_t switch_total;
+};
+
+// Runs a WindmillSim on its own thread at a fixed tick. The UI pushes
+// commands through a lock-free queue and takes snapshots from a triple
+// buffer, so neither side ever waits for the other. The thread sleeps
+// while the windmill is stopped and no commands arrive.
+class SimThread
+{
+private:
+
+  static const double tick_seconds_;
+  static const unsigned max_ticks_per_wake_;
+  static const size_t command_capacity_;
+  static const size_t max_pending_switches_;
+  static const size_t max_published_;
+
+  // what a published snapshot held, to work out what's new for the renderer
+  struct Published
+  {
+    uint64_t sequence;
+    uint64_t path_generation;
+    size_t edge_count;
+  };
+
+  WindmillSim sim_;
+
+  SpscQueue<SimCommand> commands_;
+  TripleBuffer<SimSnapshot> snapshots_;
+
+  std::thread thread_;
+  std::atomic<bool> running_;
+
+  // only wakes the thread up, the commands themselves don't need it
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+
+  // a transition table built on its own thread from a copy of the points,
+  // so the simulation keeps turning meanwhile; taken once it's ready
+  std::thread table_builder_;
+  std::unique_ptr<TransitionTable> built_table_;
+  uint64_t built_version_;
+  std::atomic<bool> table_ready_;
+
+  // simulation thread
+  uint64_t sequence_;
+  uint64_t commands_applied_;
+  uint64_t switch_total_;
+  std::deque<SnapshotSwitch> pending_switches_;
+  std::deque<Published> published_;
+  std::vector<PointId> selection_;
+
+  // written by the UI thread, read by the simulation thread
+  std::atomic<uint64_t> acknowledged_;
+
+  // UI thread
+  uint64_t commands_pushed_;
+
+  void Run();
+
+  bool ApplyCommands();
+
+  void Apply(const SimCommand& command);
+
+  void BuildTransitions();
+
+  void AdoptTransitions();
+
+  void Publish();
+
+public:
+
+  SimThread();
+  ~SimThread();
+
+  SimThread(const SimThread&) = delete;
+  SimThread& operator=(const SimThread&) = delete;
+
+  // UI thread. Waits if the queue is full
+  void Push(const SimCommand& command);
+
+  // UI thread. Takes the newest snapshot, returning false if there is none
+  // since the last call
+  bool Consume();
+
+  // UI thread
+  const SimSnapshot& getSnapshot() const { return snapshots_.getFront(); }
+
+  // UI thread. Whether commands were pushed that no snapshot reflects yet
+  bool isBehind() const;
+
+};
@@ -0,0 +1,340 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+
+#include "Coverage.h"
+
+
+const float SpatialGrid::points_per_cell_ = 2.0f;
+
+const size_t SpatialGrid::min_rebuild_count_ = 64u;
+
+// cells average points_per_cell_, so only crowded ones get split
+const size_t SpatialGrid::max_leaf_size_ = 16u;
+
+// quarters of quarters this deep are past float precision for any cell the
+// size of the scene; copies of one point just pile up in the leaf
+const unsigned SpatialGrid::max_depth_ = 24u;
+
+const uint32_t SpatialGrid::no_node_ = (uint32_t)(-1);
+
+
+SpatialGrid::SpatialGrid()
+  : cell_size_(1.0f)
+  , free_quarters_(no_node_)
+  , count_(0)
+  , built_count_(0)
+  , min_x_(INFINITY)
+  , min_y_(INFINITY)
+  , max_x_(-INFINITY)
+  , max_y_(-INFINITY)
+{
+}
+
+
+int64_t SpatialGrid::getCell(float v) const
+{
+  double cell = std::floor((double)v / cell_size_);
+
+  // keeps far away points from overflowing the key
+  return (int64_t)std::min(std::max(cell, -2147483648.0), 2147483647.0);
+}
+
+
+uint64_t SpatialGrid::getKey(int64_t cx, int64_t cy)
+{
+  return ((uint64_t)(uint32_t)cx << 32) | (uint64_t)(uint32_t)cy;
+}
+
+
+unsigned SpatialGrid::getQuarter(float x, float y, double mid_x, double mid_y)
+{
+  return (x >= mid_x ? 1u : 0u) + (y >= mid_y ? 2u : 0u);
+}
+
+
+uint32_t SpatialGrid::NewQuarters()
+{
+  uint32_t first = free_quarters_;
+  if (first != no_node_)
+  {
+    free_quarters_ = quarters_[first].quarters;
+  }
+  else
+  {
+    first = (uint32_t)quarters_.size();
+    quarters_.resize(quarters_.size() + 4);
+  }
+
+  for (unsigned q = 0; q < 4; q++)
+    quarters_[first + q].quarters = no_node_;
+
+  return first;
+}
+
+
+void SpatialGrid::FreeQuarters(uint32_t first)
+{
+  for (unsigned q = 0; q < 4; q++)
+    std::vector<GridEntry>().swap(quarters_[first + q].entries);
+
+  quarters_[first].quarters = free_quarters_;
+  free_quarters_ = first;
+}
+
+
+void SpatialGrid::Split(Node* leaf, uint32_t index, double x0, double y0, double size, unsigned depth)
+{
+  while (depth < max_depth_ && leaf->entries.size() > max_leaf_size_)
+  {
+    // may move the quarters, the leaf among them
+    uint32_t quarters = NewQuarters();
+    if (index != no_node_)
+      leaf = &quarters_[index];
+
+    std::vector<GridEntry> entries;
+    entries.swap(leaf->entries);
+    leaf->quarters = quarters;
+
+    double half = size / 2.0;
+    for (const GridEntry& e : entries)
+      quarters_[quarters + getQuarter(e.x, e.y, x0 + half, y0 + half)].entries.push_back(e);
+
+    unsigned crowded = 4;
+    for (unsigned q = 0; q < 4; q++)
+    {
+      if (quarters_[quarters + q].entries.size() > max_leaf_size_)
+        crowded = q;
+    }
+    if (crowded == 4)
+      return;
+
+    index = quarters + crowded;
+    leaf = &quarters_[index];
+    x0 += (crowded & 1u) ? half : 0.0;
+    y0 += (crowded & 2u) ? half : 0.0;
+    size = half;
+    depth++;
+  }
+}
+
+
+void SpatialGrid::InsertEntry(const GridEntry& e)
+{
+  int64_t cx = getCell(e.x), cy = getCell(e.y);
+
+  Node* node = &cells_[getKey(cx, cy)];
+
+  uint32_t index = no_node_;
+  double x0 = (double)cx * cell_size_, y0 = (double)cy * cell_size_;
+  double size = cell_size_;
+  unsigned depth = 0;
+
+  while (node->quarters != no_node_)
+  {
+    double half = size / 2.0;
+    unsigned q = getQuarter(e.x, e.y, x0 + half, y0 + half);
+
+    index = node->quarters + q;
+    node = &quarters_[index];
+    x0 += (q & 1u) ? half : 0.0;
+    y0 += (q & 2u) ? half : 0.0;
+    size = half;
+    depth++;
+  }
+
+  node->entries.push_back(e);
+  if (node->entries.size() > max_leaf_size_)
+    Split(node, index, x0, y0, size, depth);
+}
+
+
+void SpatialGrid::Rebuild()
+{
+  std::vector<GridEntry> entries;
+  entries.reserve(count_);
+  for (const auto& cell : cells_)
+    entries.insert(entries.end(), cell.second.entries.begin(), cell.second.entries.end());
+  for (const Node& node : quarters_)
+    entries.insert(entries.end(), node.entries.begin(), node.entries.end());
+
+  Build(entries);
+}
+
+
+void SpatialGrid::Build(const std::vector<GridEntry>& entries)
+{
+  min_x_ = min_y_ = INFINITY;
+  max_x_ = max_y_ = -INFINITY;
+  for (const GridEntry& e : entries)
+  {
+    min_x_ = std::min(min_x_, e.x);
+    min_y_ = std::min(min_y_, e.y);
+    max_x_ = std::max(max_x_, e.x);
+    max_y_ = std::max(max_y_, e.y);
+  }
+
+  // cells sized to hold a couple of points each on average, also when the
+  // points are spread along a line
+  double width = entries.empty() ? 0.0 : (double)max_x_ - min_x_;
+  double height = entries.empty() ? 0.0 : (double)max_y_ - min_y_;
+  double count = std::max<double>(entries.size(), 1.0);
+  double by_area = std::sqrt(width * height * points_per_cell_ / count);
+  double by_extent = std::max(width, height) * points_per_cell_ / count;
+  cell_size_ = (float)std::max({ by_area, by_extent, 1e-3 });
+
+  cells_.clear();
+  cells_.reserve((size_t)(count / points_per_cell_) + 1);
+  quarters_.clear();
+  free_quarters_ = no_node_;
+  for (const GridEntry& e : entries)
+    InsertEntry(e);
+
+  built_count_ = entries.size();
+}
+
+
+void SpatialGrid::Insert(float x, float y, PointId id)
+{
+  min_x_ = std::min(min_x_, x);
+  min_y_ = std::min(min_y_, y);
+  max_x_ = std::max(max_x_, x);
+  max_y_ = std::max(max_y_, y);
+
+  InsertEntry({ x, y, id });
+  count_++;
+
+  if (count_ >= 4 * std::max(built_count_, min_rebuild_count_))
+    Rebuild();
+}
+
+
+bool SpatialGrid::Remove(float x, float y, PointId id)
+{
+  int64_t cx = getCell(x), cy = getCell(y);
+
+  auto it = cells_.find(getKey(cx, cy));
+  if (it == cells_.end())
+    return false;
+
+  // the nodes passed on the way down, to merge on the way back up
+  Node* path[max_depth_ + 1];
+  unsigned depth = 0;
+
+  Node* node = &it->second;
+  double x0 = (double)cx * cell_size_, y0 = (double)cy * cell_size_;
+  double size = cell_size_;
+
+  while (node->quarters != no_node_)
+  {
+    double half = size / 2.0;
+    unsigned q = getQuarter(x, y, x0 + half, y0 + half);
+
+    path[depth++] = node;
+    node = &quarters_[node->quarters + q];
+    x0 += (q & 1u) ? half : 0.0;
+    y0 += (q & 2u) ? half : 0.0;
+    size = half;
+  }
+
+  auto& leaf = node->entries;
+  auto found = std::find_if(leaf.begin(), leaf.end(), 
+                            [id](const GridEntry& e)
+                            {
+                              return e.id == id;
+                            });
+  if (found == leaf.end())
+    return false;
+
+  *found = leaf.back();
+  leaf.pop_back();
+
+  // quarters down to half a leaf's worth go back into their node, so
+  // points moving about leave no trail of near empty nodes behind
+  while (depth > 0)
+  {
+    Node* parent = path[depth - 1];
+    uint32_t quarters = parent->quarters;
+
+    size_t total = 0;
+    for (unsigned q = 0; q < 4; q++)
+    {
+      if (quarters_[quarters + q].quarters != no_node_)
+        total = max_leaf_size_;
+      else
+        total += quarters_[quarters + q].entries.size();
+    }
+    if (total > max_leaf_size_ / 2)
+      break;
+
+    for (unsigned q = 0; q < 4; q++)
+      parent->entries.insert(parent->entries.end(), quarters_[quarters + q].entries.begin(), quarters_[quarters + q].entries.end());
+
+    parent->quarters = no_node_;
+    FreeQuarters(quarters);
+    depth--;
+  }
+
+  if (it->second.quarters == no_node_ && it->second.entries.empty())
+    cells_.erase(it);
+
+  count_--;
+
+  if (built_count_ > min_rebuild_count_ && count_ * 4 <= built_count_)
+    Rebuild();
+
+  return true;
+}
+
+
+void SpatialGrid::Clear()
+{
+  cells_.clear();
+  quarters_.clear();
+  free_quarters_ = no_node_;
+  count_ = built_count_ = 0;
+  cell_size_ = 1.0f;
+  min_x_ = min_y_ = INFINITY;
+  max_x_ = max_y_ = -INFINITY;
+}
+
+
+void SpatialGrid::Assign(const float* xs, const float* ys, const PointId* ids, size_t count)
+{
+  std::vector<GridEntry> entries(count);
+  for (size_t i = 0; i < count; i++)
+    entries[i] = { xs[i], ys[i], ids[i] };
+
+  count_ = count;
+  Build(entries);
+}
+
+
+bool SpatialGrid::FindNearest(float x, float y, float radius, GridEntry& found) const
+{
+  float best = radius * radius;
+  bool any = false;
+
+  QueryRect(x - radius, y - radius, x + radius, y + radius, [&](const GridEntry& e)
+            {
+              float dx = e.x - x, dy = e.y - y;
+              float d2 = dx * dx + dy * dy;
+              if (d2 < best)
+              {
+                best = d2;
+                found = e;
+                any = true;
+              }
+            });
+
+  return any;
+}
+
+
+float SpatialGrid::getCoverage(float min_x, float min_y, float max_x, float max_y) const
+{
+  if (count_ == 0)
+    return 0.0f;
+
+  return getBoxCoverage(min_x_, min_y_, max_x_, max_y_, min_x, min_y, max_x, max_y);
+}
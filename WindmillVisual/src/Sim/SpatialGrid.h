@@ -0,0 +1,189 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <math.h>
+
+#include "PointStore.h"
+
+struct GridEntry
+{
+  float x;
+  float y;
+  PointId id;
+};
+
+// Points bucketed into square cells, hashed by cell so the scene can be any
+// size. The cell size follows the point count over the bounding box and the
+// grid rebuilds itself whenever the count has grown or shrunk by a factor
+// of four. A cell holding more than a few points is split into quarters,
+// and those in turn, so a dense cluster next to a far outlier still ends
+// up in small buckets; quarters that empty out are merged back.
+class SpatialGrid
+{
+private:
+
+  static const float points_per_cell_;
+  static const size_t min_rebuild_count_;
+  static const size_t max_leaf_size_;
+  static const unsigned max_depth_;
+  static const uint32_t no_node_;
+
+  // a leaf holds entries; a split node holds none and has four quarters,
+  // stored together, x then y from the low corner
+  struct Node
+  {
+    uint32_t quarters;
+    std::vector<GridEntry> entries;
+
+    Node() : quarters(no_node_) {}
+  };
+
+  float cell_size_;
+
+  // the root of each occupied cell, by cell
+  std::unordered_map<uint64_t, Node> cells_;
+
+  // quarters in groups of four; free groups are chained through quarters
+  std::vector<Node> quarters_;
+  uint32_t free_quarters_;
+
+  size_t count_;
+  size_t built_count_;
+
+  // grows with the points, only tightened by a rebuild
+  float min_x_, min_y_, max_x_, max_y_;
+
+  int64_t getCell(float v) const;
+
+  static uint64_t getKey(int64_t cx, int64_t cy);
+
+  // Which of the quarters meeting at (mid_x, mid_y) holds the point
+  static unsigned getQuarter(float x, float y, double mid_x, double mid_y);
+
+  uint32_t NewQuarters();
+
+  void FreeQuarters(uint32_t first);
+
+  // Splits the leaf while it holds too many entries, and then the quarter
+  // they all went to, if they did. The leaf is quarters_[index], or a root
+  // when index is no_node_
+  void Split(Node* leaf, uint32_t index, double x0, double y0, double size, unsigned depth);
+
+  void InsertEntry(const GridEntry& e);
+
+  void Rebuild();
+
+  void Build(const std::vector<GridEntry>& entries);
+
+  template <typename F>
+  void QueryNode(const Node& node, double x0, double y0, double size,
+                 float min_x, float min_y, float max_x, float max_y, F& f) const;
+
+public:
+
+  SpatialGrid();
+
+  size_t size() const { return count_; }
+
+  void Insert(float x, float y, PointId id);
+
+  // Returns false if no such entry was in the grid
+  bool Remove(float x, float y, PointId id);
+
+  void Clear();
+
+  // Replaces every entry with the given points, building the cells once.
+  // Cheaper than removing and inserting when most of the points change
+  void Assign(const float* xs, const float* ys, const PointId* ids, size_t count);
+
+  // Calls f with every entry inside the rectangle
+  template <typename F>
+  void QueryRect(float min_x, float min_y, float max_x, float max_y, F f) const;
+
+  // Finds the entry closest to (x, y) within the radius. Returns false if
+  // there is none
+  bool FindNearest(float x, float y, float radius, GridEntry& found) const;
+
+  // Fraction of the points' bounding box inside the rectangle, as a cheap
+  // estimate of how much of the scene it holds
+  float getCoverage(float min_x, float min_y, float max_x, float max_y) const;
+
+};
+
+
+template <typename F>
+void SpatialGrid::QueryNode(const Node& node, double x0, double y0, double size,
+                            float min_x, float min_y, float max_x, float max_y, F& f) const
+{
+  if (node.quarters == no_node_)
+  {
+    for (const GridEntry& e : node.entries)
+    {
+      if (e.x >= min_x && e.x <= max_x && e.y >= min_y && e.y <= max_y)
+        f(e);
+    }
+    return;
+  }
+
+  // a quarter is left out only by its midlines, as those alone decide
+  // where an entry goes
+  double half = size / 2.0;
+  double mid_x = x0 + half, mid_y = y0 + half;
+  bool low_x = min_x < mid_x, high_x = max_x >= mid_x;
+  bool low_y = min_y < mid_y, high_y = max_y >= mid_y;
+
+  if (low_y && low_x)
+    QueryNode(quarters_[node.quarters], x0, y0, half, min_x, min_y, max_x, max_y, f);
+  if (low_y && high_x)
+    QueryNode(quarters_[node.quarters + 1], mid_x, y0, half, min_x, min_y, max_x, max_y, f);
+  if (high_y && low_x)
+    QueryNode(quarters_[node.quarters + 2], x0, mid_y, half, min_x, min_y, max_x, max_y, f);
+  if (high_y && high_x)
+    QueryNode(quarters_[node.quarters + 3], mid_x, mid_y, half, min_x, min_y, max_x, max_y, f);
+}
+
+
+template <typename F>
+void SpatialGrid::QueryRect(float min_x, float min_y, float max_x, float max_y, F f) const
+{
+  if (count_ == 0 || min_x > max_x || min_y > max_y)
+    return;
+
+  // no need to visit cells beyond the points
+  min_x = fmaxf(min_x, min_x_);
+  min_y = fmaxf(min_y, min_y_);
+  max_x = fminf(max_x, max_x_);
+  max_y = fminf(max_y, max_y_);
+  if (min_x > max_x || min_y > max_y)
+    return;
+
+  int64_t cx0 = getCell(min_x), cx1 = getCell(max_x);
+  int64_t cy0 = getCell(min_y), cy1 = getCell(max_y);
+
+  // a sparse grid is cheaper to walk through its occupied cells, skipping
+  // those outside the rectangle without looking inside
+  if ((double)(cx1 - cx0 + 1) * (double)(cy1 - cy0 + 1) > (double)cells_.size())
+  {
+    for (const auto& cell : cells_)
+    {
+      int64_t cx = (int32_t)(cell.first >> 32), cy = (int32_t)cell.first;
+      if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1)
+        QueryNode(cell.second, (double)cx * cell_size_, (double)cy * cell_size_, cell_size_,
+                  min_x, min_y, max_x, max_y, f);
+    }
+    return;
+  }
+
+  for (int64_t cy = cy0; cy <= cy1; cy++)
+  {
+    for (int64_t cx = cx0; cx <= cx1; cx++)
+    {
+      auto it = cells_.find(getKey(cx, cy));
+      if (it != cells_.end())
+        QueryNode(it->second, (double)cx * cell_size_, (double)cy * cell_size_, cell_size_,
+                  min_x, min_y, max_x, max_y, f);
+    }
+  }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <utility>
+#include <stddef.h>
+
+// A fixed capacity ring for one producer thread and one consumer thread,
+// without locks. Each side only writes its own index, so a push and a pop
+// never wait on each other.
+template <typename T>
+class SpscQueue
+{
+private:
+
+  std::vector<T> slots_;
+  size_t mask_;
+
+  // kept on separate cache lines, each is written by one thread only
+  std::atomic<size_t> head_;
+  char head_padding_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_;
+  char tail_padding_[64 - sizeof(std::atomic<size_t>)];
+
+public:
+
+  // The capacity is rounded up to a power of two
+  explicit SpscQueue(size_t capacity)
+    : head_(0)
+    , tail_(0)
+  {
+    size_t size = 1;
+    while (size < capacity)
+      size *= 2;
+
+    slots_.resize(size);
+    mask_ = size - 1;
+  }
+
+  // Producer side. Returns false when the queue is full
+  bool TryPush(const T& item)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == slots_.size())
+      return false;
+
+    slots_[tail & mask_] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when the queue is empty
+  bool TryPop(T& item)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return false;
+
+    // moved out, so the slot lets go of anything the item owns
+    item = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, without taking anything
+  const T* Peek() const
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire))
+      return nullptr;
+
+    return &slots_[head & mask_];
+  }
+
+  bool isEmpty() const
+  {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+};
@@ -0,0 +1,161 @@
+#include "StaticLayer.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+
+StaticLayer::StaticLayer()
+  : current_(0)
+  , available_(true)
+  , size_(0u, 0u)
+  , texel_size_(0.0f, 0.0f)
+  , origin_x_(0)
+  , origin_y_(0)
+  , points_version_((uint64_t)-1)
+  , arrows_version_((uint64_t)-1)
+  , valid_(false)
+  , dirty_(false)
+{
+}
+
+
+bool StaticLayer::Create(sf::Vector2u size)
+{
+  for (sf::RenderTexture& texture : textures_)
+  {
+    if (!texture.create(size.x, size.y))
+      return false;
+  }
+
+  size_ = size;
+  return true;
+}
+
+
+const std::vector<sf::FloatRect>& StaticLayer::Begin(const sf::View& view, sf::Vector2u window_size,
+                                                     uint64_t points_version, uint64_t arrows_version,
+                                                     bool shiftable)
+{
+  regions_.clear();
+  texel_regions_.clear();
+
+  if (!available_)
+    return regions_;
+
+  sf::Vector2f texel_size(view.getSize().x / window_size.x, view.getSize().y / window_size.y);
+  sf::Vector2f top_left = view.getCenter() - view.getSize() / 2.0f;
+
+  int64_t origin_x = (int64_t)std::floor(top_left.x / texel_size.x);
+  int64_t origin_y = (int64_t)std::floor(top_left.y / texel_size.y);
+
+  // one more texel each way, for the part of a texel the view starts into
+  sf::Vector2u size(window_size.x + 1, window_size.y + 1);
+
+  bool same = valid_ && size == size_ && texel_size == texel_size_ &&
+              points_version == points_version_ && arrows_version == arrows_version_;
+
+  if (same && origin_x == origin_x_ && origin_y == origin_y_)
+    return regions_;
+
+  int64_t dx = origin_x - origin_x_;
+  int64_t dy = origin_y - origin_y_;
+
+  texel_size_ = texel_size;
+  origin_x_ = origin_x;
+  origin_y_ = origin_y;
+  points_version_ = points_version;
+  arrows_version_ = arrows_version;
+  valid_ = true;
+  dirty_ = true;
+
+  if (same && shiftable && llabs(dx) < (int64_t)size.x && llabs(dy) < (int64_t)size.y)
+  {
+    Shift(dx, dy);
+
+    // the columns that came into view, then the rows, leaving out the
+    // corner they share so nothing is drawn twice
+    int64_t x0 = dx > 0 ? size.x - dx : 0;
+    int64_t x1 = dx > 0 ? size.x : -dx;
+    if (dx != 0)
+      AddRegion(x0, 0, x1, size.y);
+
+    int64_t y0 = dy > 0 ? size.y - dy : 0;
+    int64_t y1 = dy > 0 ? size.y : -dy;
+    if (dy != 0)
+      AddRegion(dx < 0 ? -dx : 0, y0, dx > 0 ? size.x - dx : size.x, y1);
+
+    return regions_;
+  }
+
+  if (size != size_ && !Create(size))
+  {
+    available_ = false;
+    return regions_;
+  }
+
+  textures_[current_].clear(sf::Color::Transparent);
+  AddRegion(0, 0, size.x, size.y);
+
+  return regions_;
+}
+
+
+void StaticLayer::Shift(int64_t dx, int64_t dy)
+{
+  sf::RenderTexture& from = textures_[current_];
+  current_ = 1 - current_;
+  sf::RenderTexture& to = textures_[current_];
+
+  to.setView(to.getDefaultView());
+  to.clear(sf::Color::Transparent);
+
+  sf::Sprite copy(from.getTexture());
+  copy.setPosition((float)-dx, (float)-dy);
+  to.draw(copy, sf::BlendNone);
+}
+
+
+void StaticLayer::AddRegion(int64_t x0, int64_t y0, int64_t x1, int64_t y1)
+{
+  if (x1 <= x0 || y1 <= y0)
+    return;
+
+  texel_regions_.push_back(sf::IntRect((int)x0, (int)y0, (int)(x1 - x0), (int)(y1 - y0)));
+  regions_.push_back(sf::FloatRect((origin_x_ + x0) * texel_size_.x, (origin_y_ + y0) * texel_size_.y,
+                                   (x1 - x0) * texel_size_.x, (y1 - y0) * texel_size_.y));
+}
+
+
+sf::RenderTarget& StaticLayer::getTarget(size_t region)
+{
+  sf::RenderTexture& texture = textures_[current_];
+  const sf::IntRect& texels = texel_regions_[region];
+
+  // the viewport keeps the drawing inside the region
+  sf::View view(regions_[region]);
+  view.setViewport(sf::FloatRect((float)texels.left / size_.x, (float)texels.top / size_.y,
+                                 (float)texels.width / size_.x, (float)texels.height / size_.y));
+  texture.setView(view);
+
+  return texture;
+}
+
+
+void StaticLayer::Draw(sf::RenderTarget& target)
+{
+  if (!available_ || !valid_)
+    return;
+
+  if (dirty_)
+  {
+    dirty_ = false;
+    textures_[current_].display();
+
+    sprite_.setTexture(textures_[current_].getTexture(), true);
+    sprite_.setPosition(origin_x_ * texel_size_.x, origin_y_ * texel_size_.y);
+    sprite_.setScale(texel_size_);
+  }
+
+  // what was drawn onto a clear texture already has its alpha multiplied in
+  target.draw(sprite_, sf::BlendMode(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha));
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include <SFML/Graphics.hpp>
+
+// What stays put between edits, the points and arrows, kept drawn in a
+// texture the size of the window and laid under what moves. It is only
+// drawn again when the points, the arrows or the view change, and a pan
+// keeps the pixels still in view by shifting them, so only the strips that
+// came into view are drawn. Texels sit on a fixed world grid, which makes
+// every pan a shift by whole texels.
+class StaticLayer
+{
+private:
+
+  // two, so a shift can copy from one into the other
+  sf::RenderTexture textures_[2];
+  unsigned current_;
+  bool available_;
+
+  sf::Sprite sprite_;
+
+  sf::Vector2u size_;
+  sf::Vector2f texel_size_;
+  int64_t origin_x_, origin_y_; // in texels
+
+  uint64_t points_version_;
+  uint64_t arrows_version_;
+  bool valid_;
+  bool dirty_;
+
+  // what Begin asked to be drawn, in world coordinates and in texels
+  std::vector<sf::FloatRect> regions_;
+  std::vector<sf::IntRect> texel_regions_;
+
+  bool Create(sf::Vector2u size);
+
+  void Shift(int64_t dx, int64_t dy);
+
+  void AddRegion(int64_t x0, int64_t y0, int64_t x1, int64_t y1);
+
+public:
+
+  StaticLayer();
+
+  // Lines the layer up with the view. Returns the parts of it that have to
+  // be drawn again: none when nothing changed, the strips that came into
+  // view when it can be shifted, or all of it
+  const std::vector<sf::FloatRect>& Begin(const sf::View& view, sf::Vector2u window_size,
+                                          uint64_t points_version, uint64_t arrows_version,
+                                          bool shiftable);
+
+  // The texture, set up to draw the region Begin returned at this index
+  sf::RenderTarget& getTarget(size_t region);
+
+  // For changes the versions don't tell about
+  void Invalidate() { valid_ = false; }
+
+  void Draw(sf::RenderTarget& target);
+
+  // Whether render textures work here; without them everything has to be
+  // drawn straight to the window
+  bool isAvailable() const { return available_; }
+
+};
@@ -1,37 +1,131 @@
+#define _USE_MATH_DEFINES
+
 #include "SwitchAnimation.h"
 
+#include <algorithm>
+#include <math.h>
+
+
+const size_t SwitchAnimationPool::capacity_ = 1024u;
+
+const unsigned SwitchAnimationPool::segments_ = 32u;
+
+const float SwitchAnimationPool::duration_ = 0.6f;
+
+const float SwitchAnimationPool::thickness_ = 0.25f;
+
+const float SwitchAnimationPool::initial_radius_ = 1.1f;
+
+const float SwitchAnimationPool::speed_ = 6.0f;
 
-SwitchAnimation::SwitchAnimation(sf::Vector2f position, float duration, float thickness, float initial_radius, float speed)
-	: position_(position)
-	, duration_(duration)
-	, thickness_(thickness)
-	, initial_radius_(initial_radius)
-	, speed_(speed)
-	, current_time_(0.0f)
+// switches closer together than this can't be told apart anyway
+const float SwitchAnimationPool::coalesce_time_ = 0.1f;
+
+const size_t SwitchAnimationPool::coalesce_window_ = 8u;
+
+
+SwitchAnimationPool::SwitchAnimationPool()
+	: ring_(capacity_)
+	, first_(0)
+	, count_(0)
 {
-	anim_shape_.setFillColor(sf::Color::Transparent);
-	anim_shape_.setPosition(position_);
+	for (unsigned i = 0; i <= segments_; i++)
+	{
+		float a = 2.0f * (float)M_PI * i / segments_;
+		circle_.push_back({ std::cos(a), std::sin(a) });
+	}
 }
 
 
-void SwitchAnimation::UpdateAnim(float dt)
+void SwitchAnimationPool::Push(float x, float y, PointId point_id)
 {
-	current_time_ += dt;
+	// only the newest few are looked at, they're the only ones still young
+	for (size_t i = count_; i > 0 && count_ - i < coalesce_window_; i--)
+	{
+		SwitchAnimation& anim = at(i - 1);
+		if (anim.time >= coalesce_time_)
+			break;
+
+		if (anim.point_id == point_id)
+		{
+			anim.switches++;
+			return;
+		}
+	}
+
+	if (count_ == capacity_)
+	{
+		first_ = (first_ + 1) % capacity_;
+		count_--;
+	}
+
+	at(count_) = { x, y, 0.0f, point_id, 1u };
+	count_++;
 }
 
 
-void SwitchAnimation::Draw(sf::RenderWindow & window, float circle_radius)
+void SwitchAnimationPool::Update(float dt)
 {
-	anim_shape_.setRadius(circle_radius * (initial_radius_ + current_time_ * speed_));
-	anim_shape_.setOutlineColor(sf::Color::Yellow * sf::Color(255, 255, 255, (int)(255 * (1 - current_time_ / duration_))));
-	anim_shape_.setOutlineThickness(anim_shape_.getRadius() * thickness_);
-	anim_shape_.setOrigin(anim_shape_.getRadius(), anim_shape_.getRadius());
+	for (size_t i = 0; i < count_; i++)
+		at(i).time += dt;
 
-	window.draw(anim_shape_);
+	while (count_ > 0 && at(0).time > duration_)
+	{
+		first_ = (first_ + 1) % capacity_;
+		count_--;
+	}
 }
 
 
-bool SwitchAnimation::isFinished() const
+void SwitchAnimationPool::Clear()
 {
-	return (current_time_ > duration_);
+	first_ = count_ = 0;
+}
+
+
+void SwitchAnimationPool::AppendRing(const SwitchAnimation& anim, float radius)
+{
+	// the more switches it stands for, the bolder the ring
+	float weight = std::min(1.0f + 0.25f * std::log2((float)anim.switches), 2.0f);
+	float outer = radius * (1.0f + thickness_ * weight);
+	sf::Color color(255, 255, 0, (sf::Uint8)(255 * std::max(1.0f - anim.time / duration_, 0.0f)));
+	sf::Vector2f center(anim.x, anim.y);
+
+	for (unsigned i = 0; i < segments_; i++)
+	{
+		sf::Vector2f a = circle_[i], b = circle_[i + 1];
+
+		vertices_.push_back(sf::Vertex(center + radius * a, color));
+		vertices_.push_back(sf::Vertex(center + outer * a, color));
+		vertices_.push_back(sf::Vertex(center + outer * b, color));
+		vertices_.push_back(sf::Vertex(center + radius * a, color));
+		vertices_.push_back(sf::Vertex(center + outer * b, color));
+		vertices_.push_back(sf::Vertex(center + radius * b, color));
+	}
+}
+
+
+size_t SwitchAnimationPool::Draw(sf::RenderTarget& target, const sf::FloatRect& view, float circle_radius)
+{
+	vertices_.clear();
+	size_t drawn = 0;
+
+	for (size_t i = 0; i < count_; i++)
+	{
+		const SwitchAnimation& anim = at(i);
+		float radius = circle_radius * (initial_radius_ + anim.time * speed_);
+
+		// the ring is drawn outside the circle
+		float reach = radius * (1.0f + 2.0f * thickness_);
+		if (!view.intersects(sf::FloatRect(anim.x - reach, anim.y - reach, 2 * reach, 2 * reach)))
+			continue;
+
+		AppendRing(anim, radius);
+		drawn++;
+	}
+
+	if (!vertices_.empty())
+		target.draw(vertices_.data(), vertices_.size(), sf::Triangles);
+
+	return drawn;
 }
@@ -1,25 +1,65 @@
 #pragma once
 
+#include <vector>
+
 #include <SFML/Graphics.hpp>
 
-class SwitchAnimation
+#include "PointStore.h"
+
+// A growing, fading ring where the pivot switched
+struct SwitchAnimation
+{
+	float x;
+	float y;
+	float time;
+	PointId point_id;
+	unsigned switches; // switches coalesced into this one
+};
+
+// Switch animations in a fixed ring, oldest first. They all last as long,
+// so the finished ones are always at the front; when the ring is full the
+// oldest is dropped. A switch at a point whose ring has only just started
+// is folded into it rather than starting another. All rings are drawn as
+// one triangle mesh.
+class SwitchAnimationPool
 {
 private:
-	sf::Vector2f position_;
 
-	float duration_;
-	float thickness_;
-	float initial_radius_;
-	float speed_;
-	float current_time_;
+	static const size_t capacity_;
+	static const unsigned segments_;
+	static const float duration_;
+	static const float thickness_;
+	static const float initial_radius_;
+	static const float speed_;
+	static const float coalesce_time_;
+	static const size_t coalesce_window_;
+
+	std::vector<SwitchAnimation> ring_;
+	size_t first_;
+	size_t count_;
+
+	// unit circle, segments_ + 1 points around
+	std::vector<sf::Vector2f> circle_;
+
+	std::vector<sf::Vertex> vertices_;
 
-	sf::CircleShape anim_shape_;
+	SwitchAnimation& at(size_t i) { return ring_[(first_ + i) % capacity_]; }
+
+	void AppendRing(const SwitchAnimation& anim, float radius);
 
 public:
-	SwitchAnimation(sf::Vector2f position, float duration, float thickness, float initial_radius, float speed);
 
-	void UpdateAnim(float dt);
-	void Draw(sf::RenderWindow& window, float circle_radius);
-	bool isFinished() const;
-};
+	SwitchAnimationPool();
+
+	void Push(float x, float y, PointId point_id);
+
+	void Update(float dt);
 
+	void Clear();
+
+	// Returns the number of rings drawn, all in one call
+	size_t Draw(sf::RenderTarget& target, const sf::FloatRect& view, float circle_radius);
+
+	size_t size() const { return count_; }
+
+};
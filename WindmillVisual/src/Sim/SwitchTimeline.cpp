@@ -0,0 +1,182 @@
+#include "SwitchTimeline.h"
+
+#include <algorithm>
+
+
+// as much as the angle index gets; past it the states are thinned, which
+// only delays finding the period by up to the stride
+const size_t SwitchTimeline::state_budget_ = 64u << 20;
+
+
+SwitchTimeline::SwitchTimeline(const PointStore& points, AngleIndex& angle_index, const TransitionTable& transition_table,
+                               double epsilon, size_t max_events)
+  : points_(points)
+  , angle_index_(angle_index)
+  , transition_table_(transition_table)
+  , epsilon_(epsilon)
+  , max_events_(max_events)
+{
+  Reset(0u, 0.0, 0.0);
+}
+
+
+void SwitchTimeline::Reset(unsigned pivot_slot, double rad, double total)
+{
+  origin_slot_ = last_slot_ = pivot_slot;
+  origin_rad_ = last_rad_ = rad;
+  origin_total_ = total;
+  exhausted_ = pivot_slot >= points_.size();
+
+  events_.clear();
+  states_.clear();
+  state_stride_ = 1;
+
+  period_found_ = false;
+  period_begin_ = period_size_ = 0;
+  period_rad_ = 0.0;
+}
+
+
+bool SwitchTimeline::Extend()
+{
+  if (exhausted_ || period_found_)
+    return false;
+
+  unsigned slot;
+  double delta;
+  bool hit = transition_table_.isBuilt() ? 
+    transition_table_.NextHit(points_, last_slot_, last_rad_, epsilon_, slot, delta) :
+    angle_index_.NextHit(points_, last_slot_, last_rad_, epsilon_, slot, delta);
+
+  if (!hit)
+  {
+    exhausted_ = true;
+    return false;
+  }
+
+  double total = (events_.empty() ? origin_total_ : events_.back().rad) + delta;
+
+  last_slot_ = slot;
+  last_rad_ += delta;
+  if (last_rad_ >= 2 * M_PI)
+    last_rad_ -= 2 * M_PI;
+
+  unsigned prev_slot = events_.empty() ? origin_slot_ : events_.back().slot;
+  events_.push_back({ slot, total });
+
+  uint64_t key = ((uint64_t)slot << 32) | prev_slot;
+
+  auto found = states_.find(key);
+  if (found != states_.end())
+  {
+    // everything after the first visit of this state repeats forever
+    period_found_ = true;
+    period_begin_ = found->second + 1;
+    period_size_ = events_.size() - period_begin_;
+    period_rad_ = total - events_[found->second].rad;
+    states_.clear();
+  }
+  else if (events_.size() >= max_events_)
+  {
+    // too long to hold, the timeline just ends here
+    exhausted_ = true;
+    states_.clear();
+  }
+  else
+  {
+    RecordState(key, events_.size() - 1);
+  }
+
+  return true;
+}
+
+
+void SwitchTimeline::RecordState(uint64_t key, size_t event)
+{
+  if (event % state_stride_ != 0)
+    return;
+
+  states_.emplace(key, event);
+
+  if (getStateMemory() <= state_budget_)
+    return;
+
+  state_stride_ *= 2;
+  for (auto it = states_.begin(); it != states_.end(); )
+  {
+    if (it->second % state_stride_ != 0)
+      it = states_.erase(it);
+    else
+      ++it;
+  }
+  states_.rehash(0);
+}
+
+
+size_t SwitchTimeline::getStateMemory() const
+{
+  // each map node holds the pair and a next pointer, plus one bucket pointer
+  return states_.size() * (sizeof(std::pair<const uint64_t, size_t>) + sizeof(void*)) + 
+         states_.bucket_count() * sizeof(void*);
+}
+
+
+bool SwitchTimeline::getEvent(size_t i, SwitchEvent& e)
+{
+  while (i >= events_.size() && Extend())
+    ;
+
+  if (i < events_.size())
+  {
+    e = events_[i];
+    return true;
+  }
+
+  if (!period_found_)
+    return false;
+
+  size_t periods = (i - period_begin_) / period_size_;
+  e = events_[period_begin_ + (i - period_begin_) % period_size_];
+  e.rad += periods * period_rad_;
+
+  return true;
+}
+
+
+size_t SwitchTimeline::CountBefore(double total)
+{
+  while ((events_.empty() || events_.back().rad <= total) && Extend())
+    ;
+
+  auto by_rad = [](double t, const SwitchEvent& e)
+                {
+                  return t < e.rad;
+                };
+
+  if (!period_found_ || total < events_.back().rad)
+    return std::upper_bound(events_.begin(), events_.end(), total, by_rad) - events_.begin();
+
+  // fold the time back into the first period
+  double period_start = events_[period_begin_].rad;
+  double periods = std::floor((total - period_start) / period_rad_);
+
+  auto begin = events_.begin() + period_begin_;
+  size_t within = std::upper_bound(begin, events_.end(), total - periods * period_rad_, by_rad) - begin;
+
+  return period_begin_ + (size_t)periods * period_size_ + within;
+}
+
+
+bool SwitchTimeline::FindPeriod()
+{
+  while (Extend())
+    ;
+
+  return period_found_;
+}
+
+
+size_t SwitchTimeline::getMemoryUsed() const
+{
+  return events_.capacity() * sizeof(SwitchEvent) + getStateMemory();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "PointStore.h"
+#include "AngleIndex.h"
+#include "TransitionTable.h"
+
+struct SwitchEvent
+{
+  unsigned slot; // the point that becomes pivot
+  double rad;    // total rotation of the line when it does
+};
+
+// Every pivot switch from a starting state on, computed ahead on demand.
+// Once a state repeats, the events of one period are kept and all later
+// events are derived from them, so any point in time can be found with a
+// binary search. A state is the pivot with the previous pivot, which fixes
+// the line exactly.
+class SwitchTimeline
+{
+private:
+
+  static const size_t state_budget_;
+
+  const PointStore& points_;
+  AngleIndex& angle_index_;
+  const TransitionTable& transition_table_;
+
+  double epsilon_;
+  size_t max_events_;
+
+  unsigned origin_slot_;
+  double origin_rad_;
+  double origin_total_;
+
+  // state after the last computed event
+  unsigned last_slot_;
+  double last_rad_;
+  bool exhausted_;
+
+  std::vector<SwitchEvent> events_;
+
+  // states of every state_stride_-th event, thinned out whenever they grow
+  // past the budget; a recorded state inside the period still comes round
+  std::unordered_map<uint64_t, size_t> states_;
+  size_t state_stride_;
+
+  bool period_found_;
+  size_t period_begin_;
+  size_t period_size_;
+  double period_rad_;
+
+  bool Extend();
+
+  void RecordState(uint64_t key, size_t event);
+
+  size_t getStateMemory() const;
+
+public:
+
+  SwitchTimeline(const PointStore& points, AngleIndex& angle_index, const TransitionTable& transition_table,
+                 double epsilon, size_t max_events);
+
+  void Reset(unsigned pivot_slot, double rad, double total);
+
+  bool getEvent(size_t i, SwitchEvent& e);
+
+  size_t CountBefore(double total);
+
+  bool FindPeriod();
+
+  bool isPeriodFound() const { return period_found_; }
+
+  size_t getRecordedCount() const { return events_.size(); }
+
+  const SwitchEvent& getRecorded(size_t i) const { return events_[i]; }
+
+  unsigned getOriginSlot() const { return origin_slot_; }
+  double getOriginRad() const { return origin_rad_; }
+  double getOriginTotal() const { return origin_total_; }
+
+  size_t getMemoryUsed() const;
+
+};
@@ -0,0 +1,163 @@
+#include "Trace.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+struct TraceEvent
+{
+  const char* name;
+  int64_t begin;
+  int64_t end;
+};
+
+// Written by the one thread holding it, read by whoever writes the JSON
+struct TraceBuffer
+{
+  static const uint64_t capacity = 1u << 16;
+
+  std::vector<TraceEvent> events;
+  std::atomic<uint64_t> head; // events ever written
+  std::atomic<bool> in_use;
+  unsigned tid;
+
+  explicit TraceBuffer(unsigned tid)
+    : events(capacity)
+    , head(0)
+    , in_use(true)
+    , tid(tid)
+  {
+  }
+};
+
+struct TraceRegistry
+{
+  std::mutex mutex;
+  std::vector<std::unique_ptr<TraceBuffer>> buffers;
+};
+
+static TraceRegistry& getRegistry()
+{
+  static TraceRegistry registry;
+  return registry;
+}
+
+// Hands the buffer back when its thread exits, so short lived worker threads
+// don't keep adding buffers
+struct BufferHolder
+{
+  TraceBuffer* buffer = nullptr;
+
+  ~BufferHolder()
+  {
+    if (buffer)
+      buffer->in_use.store(false, std::memory_order_release);
+  }
+};
+
+static thread_local BufferHolder holder;
+
+static TraceBuffer* AcquireBuffer()
+{
+  TraceRegistry& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  for (auto& buffer : registry.buffers)
+  {
+    bool free = false;
+    if (buffer->in_use.compare_exchange_strong(free, true, std::memory_order_acquire))
+      return buffer.get();
+  }
+
+  registry.buffers.emplace_back(new TraceBuffer((unsigned)registry.buffers.size() + 1));
+  return registry.buffers.back().get();
+}
+
+
+std::atomic<bool> Trace::enabled_(false);
+
+std::atomic<int64_t> Trace::session_begin_(0);
+
+
+void Trace::setEnabled(bool enabled)
+{
+  if (enabled && !isEnabled())
+    session_begin_.store(Now(), std::memory_order_relaxed);
+
+  enabled_.store(enabled, std::memory_order_relaxed);
+}
+
+
+int64_t Trace::Now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void Trace::Record(const char* name, int64_t begin, int64_t end)
+{
+  if (!holder.buffer)
+    holder.buffer = AcquireBuffer();
+
+  TraceBuffer& buffer = *holder.buffer;
+
+  uint64_t head = buffer.head.load(std::memory_order_relaxed);
+  buffer.events[head & (TraceBuffer::capacity - 1)] = { name, begin, end };
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+
+bool Trace::WriteJson(const char* path)
+{
+  FILE* file = fopen(path, "w");
+  if (!file)
+    return false;
+
+  int64_t session_begin = session_begin_.load(std::memory_order_relaxed);
+
+  std::vector<TraceEvent> events;
+  bool first = true;
+
+  fprintf(file, "{\"traceEvents\":[\n");
+
+  TraceRegistry& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+
+  for (auto& buffer : registry.buffers)
+  {
+    uint64_t end = buffer->head.load(std::memory_order_acquire);
+    uint64_t begin = end > TraceBuffer::capacity ? end - TraceBuffer::capacity : 0;
+
+    events.clear();
+    for (uint64_t i = begin; i < end; i++)
+      events.push_back(buffer->events[i & (TraceBuffer::capacity - 1)]);
+
+    // the owning thread may have lapped the oldest events while they were copied
+    uint64_t after = buffer->head.load(std::memory_order_acquire);
+    size_t skip = 0;
+    if (after > TraceBuffer::capacity && after - TraceBuffer::capacity > begin)
+      skip = (size_t)std::min<uint64_t>(after - TraceBuffer::capacity - begin, events.size());
+
+    for (size_t i = skip; i < events.size(); i++)
+    {
+      const TraceEvent& e = events[i];
+      if (e.begin < session_begin)
+        continue;
+
+      fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+              first ? "" : ",\n", e.name, buffer->tid,
+              (e.begin - session_begin) / 1000.0, (e.end - e.begin) / 1000.0);
+      first = false;
+    }
+  }
+
+  fprintf(file, "\n]}\n");
+
+  return fclose(file) == 0;
+}
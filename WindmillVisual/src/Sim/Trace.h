@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Scoped spans recorded into a ring buffer per thread and written out as
+// Chrome trace events, for chrome://tracing or ui.perfetto.dev. While
+// recording is off a span costs one relaxed load.
+class Trace
+{
+private:
+
+  static std::atomic<bool> enabled_;
+  static std::atomic<int64_t> session_begin_;
+
+public:
+
+  static bool isEnabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Starting a recording drops the spans of earlier ones
+  static void setEnabled(bool enabled);
+
+  // Nanoseconds on a steady clock
+  static int64_t Now();
+
+  static void Record(const char* name, int64_t begin, int64_t end);
+
+  // Writes the spans of the current recording that are still in the buffers
+  static bool WriteJson(const char* path);
+
+};
+
+
+class TraceScope
+{
+private:
+
+  const char* name_;
+  int64_t begin_;
+
+public:
+
+  explicit TraceScope(const char* name)
+    : name_(Trace::isEnabled() ? name : nullptr)
+    , begin_(name_ ? Trace::Now() : 0)
+  {
+  }
+
+  ~TraceScope()
+  {
+    if (name_)
+      Trace::Record(name_, begin_, Trace::Now());
+  }
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+};
+
+
+// Defining WINDMILL_NO_TRACE compiles every span out
+#ifdef WINDMILL_NO_TRACE
+#define TRACE_SCOPE(name)
+#else
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#endif
@@ -0,0 +1,145 @@
+#include "TransitionTable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "Trace.h"
+
+
+// a row of n entries shares each quantum between about n / 65536 of them,
+// so a lookup works out one or two exact angles
+const unsigned TransitionTable::quantum_bits_ = 16u;
+
+const size_t TransitionTable::max_points_ = (size_t)1u << 16;
+
+
+TransitionTable::TransitionTable()
+  : row_size_(0)
+  , built_(false)
+{
+}
+
+
+size_t TransitionTable::getMemoryNeeded(size_t point_count)
+{
+  size_t row_size = point_count > 0 ? point_count - 1 : 0;
+  return point_count * (sizeof(unsigned) + row_size * (sizeof(uint16_t) + sizeof(uint16_t)));
+}
+
+
+bool TransitionTable::Build(const PointStore& points, unsigned thread_count, size_t memory_budget)
+{
+  Clear();
+
+  size_t n = points.size();
+  if (n < 2 || n > max_points_ || getMemoryNeeded(n) > memory_budget)
+    return false;
+
+  row_size_ = n - 1;
+  counts_.assign(n, 0u);
+  quanta_.resize(n * row_size_);
+  targets_.resize(n * row_size_);
+
+  // every row is independent, workers take the next unbuilt one
+  std::atomic<size_t> next_row(0);
+  auto work = [&]()
+              {
+                TRACE_SCOPE("TransitionTable::BuildRows");
+
+                std::vector<AngleEntry> entries;
+                for (size_t p = next_row++; p < n; p = next_row++)
+                  BuildRow(points, p, entries);
+              };
+
+  thread_count = std::max(1u, std::min(thread_count, (unsigned)n));
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 1; i < thread_count; i++)
+    workers.emplace_back(work);
+
+  work();
+
+  for (auto& worker : workers)
+    worker.join();
+
+  built_ = true;
+  return true;
+}
+
+
+void TransitionTable::BuildRow(const PointStore& points, size_t pivot_slot, std::vector<AngleEntry>& entries)
+{
+  AngleIndex::BuildOrder(points, pivot_slot, entries);
+
+  size_t row = pivot_slot * row_size_;
+  for (size_t i = 0; i < entries.size(); i++)
+  {
+    quanta_[row + i] = Quantize(entries[i].angle);
+    targets_[row + i] = (uint16_t)entries[i].slot;
+  }
+  counts_[pivot_slot] = (unsigned)entries.size();
+}
+
+
+void TransitionTable::Clear()
+{
+  built_ = false;
+  row_size_ = 0;
+
+  // release the memory, the table can be very large
+  std::vector<unsigned>().swap(counts_);
+  std::vector<uint16_t>().swap(quanta_);
+  std::vector<uint16_t>().swap(targets_);
+}
+
+
+size_t TransitionTable::getMemoryUsed() const
+{
+  return counts_.capacity() * sizeof(unsigned) + 
+         quanta_.capacity() * sizeof(uint16_t) + 
+         targets_.capacity() * sizeof(uint16_t);
+}
+
+
+uint16_t TransitionTable::Quantize(double angle)
+{
+  // rounds down, so it never reorders angles
+  double quantum = angle * ((double)(1u << quantum_bits_) / M_PI);
+  return (uint16_t)std::min(quantum, (double)((1u << quantum_bits_) - 1));
+}
+
+
+bool TransitionTable::NextHit(const PointStore& points, size_t pivot_slot, double rad, double epsilon,
+                              unsigned& slot, double& delta) const
+{
+  const uint16_t* quanta = quanta_.data() + pivot_slot * row_size_;
+  const uint16_t* targets = targets_.data() + pivot_slot * row_size_;
+
+  // exactly as AngleIndex::BuildOrder had it
+  double px = points.x(pivot_slot);
+  double py = points.y(pivot_slot);
+  auto angle_at = [&](size_t i)
+                  {
+                    return AngleIndex::ToHalfTurn(std::atan2(points.y(targets[i]) - py, points.x(targets[i]) - px));
+                  };
+
+  // angles in a lower quantum than the key's are below it and those in a
+  // higher one above, only the key's own quantum needs the exact angle
+  uint16_t key_quantum = Quantize(AngleIndex::getHitKey(rad, epsilon));
+  auto order_at = [&](size_t i)
+                  {
+                    if (quanta[i] < key_quantum)
+                      return -1.0;
+                    if (quanta[i] > key_quantum)
+                      return 2.0 * M_PI;
+                    return angle_at(i);
+                  };
+
+  size_t index;
+  if (!AngleIndex::NextHitIndex(counts_[pivot_slot], order_at, angle_at, rad, epsilon, index, delta))
+    return false;
+
+  slot = targets[index];
+  return true;
+}
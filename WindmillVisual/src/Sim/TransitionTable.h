@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "PointStore.h"
+#include "AngleIndex.h"
+
+// The sorted angular order around every point, computed up front. For a given
+// pivot, consecutive angles bound the phases of the line that lead to the same
+// next pivot, so finding a switch is a lookup in this table. Entries keep the
+// angle only coarsely; the exact angle is worked out from the points for the
+// few entries the coarse one can't place.
+class TransitionTable
+{
+private:
+
+  static const unsigned quantum_bits_;
+
+  // row p holds counts_[p] entries starting at p * row_size_
+  size_t row_size_;
+  std::vector<unsigned> counts_;
+  std::vector<uint16_t> quanta_;
+  std::vector<uint16_t> targets_;
+
+  bool built_;
+
+  void BuildRow(const PointStore& points, size_t pivot_slot, std::vector<AngleEntry>& entries);
+
+  static uint16_t Quantize(double angle);
+
+public:
+
+  // targets are kept in 16 bits
+  static const size_t max_points_;
+
+  TransitionTable();
+
+  bool Build(const PointStore& points, unsigned thread_count, size_t memory_budget);
+
+  void Clear();
+
+  bool isBuilt() const { return built_; }
+
+  size_t getMemoryUsed() const;
+
+  // points must be the ones the table was built from
+  bool NextHit(const PointStore& points, size_t pivot_slot, double rad, double epsilon,
+               unsigned& slot, double& delta) const;
+
+  static size_t getMemoryNeeded(size_t point_count);
+
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+
+// Hands the newest of a stream of values from one thread to another without
+// locks. The producer fills the back buffer and swaps it with the middle
+// one; the consumer swaps the middle one for its front buffer when it holds
+// something new. Neither side ever waits, the consumer just skips values it
+// was too slow to see.
+template <typename T>
+class TripleBuffer
+{
+private:
+
+  static const unsigned fresh_bit_ = 4u;
+  static const unsigned index_mask_ = 3u;
+
+  T buffers_[3];
+
+  // index of the middle buffer, with fresh_bit_ set while it's unread
+  std::atomic<unsigned> middle_;
+
+  unsigned back_;
+  unsigned front_;
+
+public:
+
+  TripleBuffer()
+    : buffers_()
+    , middle_(1u)
+    , back_(0u)
+    , front_(2u)
+  {
+  }
+
+  // Producer side: the buffer to fill next. It still holds whatever it held
+  // when it was last handed over, so it can be updated rather than rebuilt
+  T& getBack() { return buffers_[back_]; }
+
+  void Publish()
+  {
+    back_ = middle_.exchange(back_ | fresh_bit_, std::memory_order_acq_rel) & index_mask_;
+  }
+
+  // Consumer side: takes the newest published value, if there is one
+  bool Consume()
+  {
+    if (!(middle_.load(std::memory_order_relaxed) & fresh_bit_))
+      return false;
+
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & index_mask_;
+    return true;
+  }
+
+  const T& getFront() const { return buffers_[front_]; }
+
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <math.h>
+
+struct Vec2
+{
+  float x;
+  float y;
+
+  bool operator==(const Vec2& other) const
+  {
+    return x == other.x && y == other.y;
+  }
+
+  bool operator!=(const Vec2& other) const
+  {
+    return !(*this == other);
+  }
+};
+
+// An affine map, x' = a x + b y + tx and y' = c x + d y + ty. Built the same
+// way from the same arguments it maps to the same floats, so two copies of
+// the points moved by it stay identical
+struct Transform2
+{
+  float a, b, c, d;
+  float tx, ty;
+
+  Vec2 Apply(Vec2 v) const
+  {
+    return { a * v.x + b * v.y + tx, c * v.x + d * v.y + ty };
+  }
+
+  static Transform2 Translation(Vec2 offset)
+  {
+    return { 1.0f, 0.0f, 0.0f, 1.0f, offset.x, offset.y };
+  }
+
+  static Transform2 Rotation(Vec2 center, double rad)
+  {
+    float cos_a = (float)cos(rad);
+    float sin_a = (float)sin(rad);
+
+    return { cos_a, -sin_a, sin_a, cos_a,
+             center.x - cos_a * center.x + sin_a * center.y,
+             center.y - sin_a * center.x - cos_a * center.y };
+  }
+
+  static Transform2 Scaling(Vec2 center, double factor)
+  {
+    float s = (float)factor;
+
+    return { s, 0.0f, 0.0f, s, center.x - s * center.x, center.y - s * center.y };
+  }
+};
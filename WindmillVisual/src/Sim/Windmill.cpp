@@ -1,202 +1,269 @@
 #include "Windmill.h"
 
+#include "Trace.h"
 
-const double Windmill::default_angular_speed_ = 0.45;
 
-unsigned Point::index_count = 0u;
+float Windmill::arrowhead_proportion_ = 0.025f;
 
-float Point::arrowhead_proportion = 0.025f;
+const float Windmill::density_points_per_pixel_ = 2.0f;
 
-double Point::arrow_angle = 0.4;
+// past this only the bounding box shows what is selected
+const size_t Windmill::max_marked_selection_ = 100000u;
 
-sf::RectangleShape Point::shaft({ 1.f, 1.f });
 
-sf::VertexArray Point::arrowhead(sf::Triangles, 3u);
-
-
-Point::Point(sf::Vector2f position)
-  : position(position)
-  , index(index_count++)
+static sf::Vector2f ToSf(Vec2 v)
 {
-  shaft.setOrigin({ 0.0f, 0.5f }); // sets origin to center
-}
-
-unsigned Point::getIndexCount()
-{
-  return index_count++;
+  return { v.x, v.y };
 }
 
 
 Windmill::Windmill(const sf::SoundBuffer& sound_buffer)
-	: points_()
-  , current_pivot_()
-  , prev_pivot_index_((unsigned)(-1))
-	, pivot_set_(false)
-  , rad_since_pivot_(0.0)
-	, current_rad_(0.0)
-	, rads_per_second_(default_angular_speed_)
+	: sim_thread_()
+  , scene_()
+  , path_generation_(0)
+  , edge_count_(0)
+  , snapshot_sequence_(0)
+  , switch_total_(0)
 	, pt_proportion_size_(0.005f)
+  , pt_radius_(0.0f)
+  , point_renderer_()
+  , erased_slots_()
+  , hover_shape_()
+  , hover_id_(0)
+  , hover_set_(false)
   , line_shape_({ 1.f, 1.f })
+  , selection_()
+  , lasso_()
+  , selection_bounds_()
+  , selection_box_()
+  , selection_marks_(sf::Points)
+  , selection_version_((uint64_t)-1)
+  , arrow_renderer_()
+  , density_renderer_()
+  , static_layer_()
+  , layer_dense_(false)
 	, click_sound_(sound_buffer)
-	, paused_(false)
-	, started_(false)
   , arrows_shown_(true)
+  , draw_stats_()
+  , frame_switches_(0)
 {
-	pt_shape_.setFillColor(sf::Color::Transparent);
-	pt_shape_.setOutlineColor(sf::Color::White);
-
 	pt_pivot_shape_.setFillColor(sf::Color::Yellow);
 
+  hover_shape_.setFillColor(sf::Color::Transparent);
+  hover_shape_.setOutlineColor(sf::Color(120, 200, 255));
+
   line_shape_.setOrigin({ 0.5f, 0.5f }); // sets origin to center
   line_shape_.setFillColor(sf::Color(255, 40, 10));
+
+  selection_box_.setFillColor(sf::Color(120, 200, 255, 24));
+  selection_box_.setOutlineColor(sf::Color(120, 200, 255));
 }
 
 
-void Windmill::Start()
+void Windmill::Push(SimCommand::Type type, Vec2 position, PointId id, double value)
 {
-  animations_.clear();
+  sim_thread_.Push(SimCommand(type, position, id, value));
+}
 
-	if (!pivot_set_)
-	{
-		current_pivot_ = *(points_.end() - 1);
-		pivot_set_ = true;
-	}
 
-	started_ = true;
+void Windmill::Start()
+{
+  animations_.Clear();
 
-	UpdatePoints();
-	for (auto point : points_)
-	{
-		point.prev_on_clockwise = point.on_clockwise;
-	}
-	prev_pivot_index_ = current_pivot_.index;
+  Push(SimCommand::Type::kStart);
 }
 
 
 void Windmill::TogglePause()
 {
-	paused_ = !paused_;
+  Push(SimCommand::Type::kTogglePause);
 }
 
 
 void Windmill::Restart()
 {
-	points_.clear();
-  vectors_.clear();
-	animations_.clear();
+	animations_.Clear();
+
+  scene_.Clear();
+  hover_set_ = false;
+  selection_.clear();
 
-	started_ = false;
-	pivot_set_ = false;
-	paused_ = false;
-	rads_per_second_ = default_angular_speed_;
-	current_rad_ = 0;
+  // the simulation starts a new path too, but its next snapshot may be a
+  // while coming
+  arrow_renderer_.Clear();
+  edge_count_ = 0;
+
+  Push(SimCommand::Type::kRestart);
 }
 
 
-void Windmill::UpdateLine(float dt, float length)
+void Windmill::UpdateLine()
 {
-	current_rad_ += rads_per_second_ * dt;
-	rad_since_pivot_ += rads_per_second_ * dt;
-
-	if (current_rad_ >= 2 * M_PI)
-		current_rad_ -= 2 * M_PI;
+  const SimSnapshot& snapshot = sim_thread_.getSnapshot();
 
-  line_shape_.setPosition(current_pivot_.position);
-  line_shape_.setRotation((float)(current_rad_ * 180.0f / M_PI));
+  line_shape_.setPosition(ToSf(snapshot.pivot_position));
+  line_shape_.setRotation((float)(snapshot.line_angle * 180.0f / M_PI));
 }
 
 
-void Windmill::Update(float dt, float length)
+void Windmill::ApplySnapshot()
 {
-	if (!started_ || !pivot_set_)
-		return;
-  
-  if (paused_)
+  const SimSnapshot& snapshot = sim_thread_.getSnapshot();
+
+  if (snapshot.path_generation != path_generation_)
   {
-    UpdateLine(0.0f, length);
-    return;
+    path_generation_ = snapshot.path_generation;
+    edge_count_ = 0;
+
+    arrow_renderer_.Clear();
   }
 
-  UpdateLine(dt, length);
+  // the snapshot may repeat a few edges this side already has. Its slots
+  // are only this side's once the simulation has caught up with the points;
+  // until then its path is on the way out, as every edit clears it
+  const PointStore& points = scene_.getPoints();
+  if (snapshot.first_edge <= edge_count_ && snapshot.points_version == points.getVersion())
+  {
+    for (size_t i = edge_count_ - snapshot.first_edge; i < snapshot.edges.size(); i++)
+    {
+      const PathEdge& edge = snapshot.edges[i];
+      arrow_renderer_.Add({ points.x(edge.from), points.y(edge.from) }, { points.x(edge.to), points.y(edge.to) });
+    }
 
-	for (auto& anim : animations_)
-		anim.UpdateAnim(dt);
-	
-	UpdatePoints();
-	if (CheckPointSwitches())
-	{
-		click_sound_.play();
-
-		animations_.push_back(SwitchAnimation(current_pivot_.position,
-											  0.6f, // duration
-											  0.25f, // thickness
-											  1.1f, // initial radius 
-											  6.0f // speed
-											  ));
-	}
-	auto test_finished = std::remove_if(animations_.begin(), 
-                                      animations_.end(), 
-                                      [](const SwitchAnimation& anim)
-	                                    {
-		                                    return anim.isFinished();
-	                                    });
-	animations_.erase(test_finished, animations_.end());
+    edge_count_ = snapshot.first_edge + snapshot.edges.size();
+  }
+
+  for (const SnapshotSwitch& event : snapshot.switches)
+  {
+    if (event.sequence > snapshot_sequence_)
+      animations_.Push(event.position.x, event.position.y, event.id);
+  }
+
+  frame_switches_ = (size_t)(snapshot.switch_total - switch_total_);
+  switch_total_ = snapshot.switch_total;
+  snapshot_sequence_ = snapshot.sequence;
+
+  if (frame_switches_ > 0)
+    click_sound_.play();
+}
+
+
+void Windmill::Update(float dt, float length)
+{
+  TRACE_SCOPE("Windmill::Update");
+
+  frame_switches_ = 0;
+
+  // the rings only grow while the windmill turns
+  const SimSnapshot& before = sim_thread_.getSnapshot();
+  if (before.started && before.pivot_set && !before.paused)
+    animations_.Update(dt);
+
+  // Consume hands the old front buffer back to the simulation thread, so
+  // the snapshot has to be looked up again after it
+  if (sim_thread_.Consume())
+    ApplySnapshot();
+
+  const SimSnapshot& snapshot = sim_thread_.getSnapshot();
+  if (snapshot.started && snapshot.pivot_set)
+    UpdateLine();
 }
 
 
 void Windmill::UpdatePointSize(sf::RenderWindow & window, sf::View & world_view)
 {
-	pt_shape_.setRadius(pt_proportion_size_ * world_view.getSize().y);
-	pt_shape_.setOutlineThickness(pt_shape_.getRadius() * 0.3f);
-	pt_shape_.setOrigin(pt_shape_.getRadius(), pt_shape_.getRadius());
+	pt_radius_ = pt_proportion_size_ * world_view.getSize().y;
 
 	pt_pivot_shape_.setRadius(1.5f * pt_proportion_size_ * world_view.getSize().y);
 	pt_pivot_shape_.setOrigin(pt_pivot_shape_.getRadius(), pt_pivot_shape_.getRadius());
+
+  hover_shape_.setRadius(1.5f * pt_radius_);
+  hover_shape_.setOrigin(hover_shape_.getRadius(), hover_shape_.getRadius());
+  hover_shape_.setOutlineThickness(0.3f * pt_radius_);
 }
 
 
 void Windmill::Draw(sf::RenderWindow& window, sf::View& world_view)
 {
+  TRACE_SCOPE("Windmill::Draw");
+
 	UpdatePointSize(window, world_view);
 
+  draw_stats_ = DrawStats();
+
+  // only what intersects this is drawn
+  sf::FloatRect view_rect(world_view.getCenter() - world_view.getSize() / 2.0f, world_view.getSize());
+  float pixel_size = world_view.getSize().y / (float)window.getSize().y;
+  bool dense = isDense(view_rect, pixel_size);
+
+  short_arrows_.clear();
   if (arrows_shown_)
-    DrawVectors(window, world_view);
+  {
+    // the shaft is 2 pixels thick
+    arrow_renderer_.Sync(2.0f * pixel_size, arrowhead_proportion_ * world_view.getSize().y);
+    arrow_renderer_.getShortArrows(pixel_size, short_arrows_);
+  }
+
+  DrawStatic(window, world_view, pixel_size, dense);
+
+  const SimSnapshot& snapshot = sim_thread_.getSnapshot();
 
-  if (started_)
+  if (snapshot.started)
   {
     // sets line very long and 2 pixels thick
-    auto diff = world_view.getCenter() - current_pivot_.position;
+    auto diff = world_view.getCenter() - ToSf(snapshot.pivot_position);
     auto dist = std::sqrt(diff.x * diff.x + diff.y * diff.y);
     line_shape_.setScale(2 * (dist + world_view.getSize().x + world_view.getSize().y),
       2.0f * world_view.getSize().y / (float)window.getSize().y);
 
     window.draw(line_shape_);
+    draw_stats_.draw_calls++;
   }
 
-  // Draw the point circles
-	for (auto& pt : points_)
-	{
-		if (pivot_set_ && pt == current_pivot_)
-		{
-			pt_pivot_shape_.setPosition(pt.position);
-			window.draw(pt_pivot_shape_);
-		}
-		else
-		{
-			pt_shape_.setPosition(pt.position);
-			window.draw(pt_shape_);
-		}
-	}
+  if (snapshot.pivot_set)
+  {
+    pt_pivot_shape_.setPosition(ToSf(snapshot.pivot_position));
+    window.draw(pt_pivot_shape_);
+    draw_stats_.draw_calls++;
+  }
+
+  if (!selection_.empty())
+  {
+    SyncSelection();
+
+    selection_box_.setPosition(selection_bounds_.left, selection_bounds_.top);
+    selection_box_.setSize({ selection_bounds_.width, selection_bounds_.height });
+    selection_box_.setOutlineThickness(pixel_size);
+    window.draw(selection_box_);
+    draw_stats_.draw_calls++;
+
+    if (selection_marks_.getVertexCount() > 0)
+    {
+      window.draw(selection_marks_);
+      draw_stats_.draw_calls++;
+    }
+  }
+
+  if (hover_set_)
+  {
+    size_t slot = scene_.getPoints().FindSlot(hover_id_);
+    if (slot != WindmillSim::no_slot_)
+    {
+      hover_shape_.setPosition(scene_.getPoints().x(slot), scene_.getPoints().y(slot));
+      window.draw(hover_shape_);
+      draw_stats_.draw_calls++;
+    }
+  }
 	
   // Draw the "pop" animations
-	if (started_)
-		AnimateSwitches(window, pt_pivot_shape_.getRadius());
+	if (snapshot.started)
+		AnimateSwitches(window, view_rect, pt_pivot_shape_.getRadius());
 }
 
 
 void Windmill::DrawPausedSymbol(sf::RenderWindow& window, sf::View& gui_view)
 {
-  if (!paused_)
+  if (!sim_thread_.getSnapshot().paused)
     return;
 
   sf::RectangleShape bar(sf::Vector2f(8.0f, 30.0f));
@@ -214,235 +281,411 @@ void Windmill::DrawPausedSymbol(sf::RenderWindow& window, sf::View& gui_view)
 
 void Windmill::AddPoint(sf::Vector2f pos)
 {
-	points_.push_back(Point(pos));
-	if (started_ && pivot_set_)
-	{
-		points_.back().on_clockwise = points_.back().prev_on_clockwise = CheckPointSide(points_.back());
-	}
-  vectors_.clear();
+  AddPoints(&pos, 1);
 }
 
 
-bool Windmill::ChoosePivot(sf::Vector2f click_pos)
+void Windmill::AddPoints(const sf::Vector2f* positions, size_t count)
 {
-	for (auto& pt : points_)
-	{
-		if (sqrt(pow(pt.position.x - click_pos.x, 2.0f) + pow(pt.position.y - click_pos.y, 2))
-			  < pt_pivot_shape_.getRadius() * 1.5f)
-		{
-			current_pivot_ = pt;
-			pivot_set_ = true;
-			UpdatePoints();
+  TRACE_SCOPE("Windmill::AddPoints");
+
+  bool in_sync = point_renderer_.isInSync(scene_.getPoints());
+  size_t first = scene_.getPoints().size();
+
+  auto added = std::make_shared<std::vector<Vec2>>(count);
+  for (size_t i = 0; i < count; i++)
+    (*added)[i] = { positions[i].x, positions[i].y };
+
+  scene_.AddPoints(*added);
+
+  // the batch goes over as one command, whatever its size
+  SimCommand command(SimCommand::Type::kAddPoints);
+  command.positions = added;
+  sim_thread_.Push(command);
+
+  if (in_sync)
+    point_renderer_.Add(scene_.getPoints(), first);
+}
 
-      vectors_.clear();
 
-			return true;
-		}
-	}
+bool Windmill::ChoosePivot(sf::Vector2f click_pos)
+{
+  size_t slot = scene_.FindPoint({ click_pos.x, click_pos.y }, pt_pivot_shape_.getRadius() * 1.5f);
+  if (slot == WindmillSim::no_slot_)
+    return false;
 
-	return false;
+  Push(SimCommand::Type::kChoosePivot, { 0.0f, 0.0f }, scene_.getPoints().id(slot));
+	return true;
 }
 
 
 void Windmill::TryDelete(sf::Vector2f click_pos)
 {
-	for (auto it = points_.begin(); it != points_.end(); it++)
-	{
-		if (std::sqrt(std::pow(it->position.x - click_pos.x, 2.0f) + std::pow(it->position.y - click_pos.y, 2))
-			< pt_shape_.getRadius() * 1.5f)
-		{
-			if (pivot_set_ && *it == current_pivot_)
-				pivot_set_ = started_ = false;
+  size_t slot = scene_.FindPoint({ click_pos.x, click_pos.y }, pt_radius_ * 1.5f);
+  if (slot == WindmillSim::no_slot_)
+    return;
+
+  bool in_sync = point_renderer_.isInSync(scene_.getPoints());
+  PointId id = scene_.getPoints().id(slot);
 
-			points_.erase(it);
+  scene_.DeletePoints(&id, 1, erased_slots_);
+  Push(SimCommand::Type::kDeletePoint, { 0.0f, 0.0f }, id);
 
-      vectors_.clear();
+  if (hover_set_ && hover_id_ == id)
+    hover_set_ = false;
 
-			return;
-		}
-	}
+  if (in_sync)
+    point_renderer_.Remove(scene_.getPoints(), erased_slots_);
 }
 
 
-void Windmill::MultiplyAngularSpeed(double m_speed)
+void Windmill::SelectRect(const sf::FloatRect& rect)
 {
-	rads_per_second_ *= m_speed;
+  TRACE_SCOPE("Windmill::SelectRect");
+
+  selection_.clear();
+  scene_.FindPointsInRect({ rect.left, rect.top }, { rect.left + rect.width, rect.top + rect.height }, selection_);
 
-	if (rads_per_second_ < 0.001)
-		rads_per_second_ = 0.001;
-	else if (rads_per_second_ > 2)
-		rads_per_second_ = 2;
+  SendSelection();
 }
 
 
-bool Windmill::isPivotSet()
+void Windmill::SelectLasso(const std::vector<sf::Vector2f>& polygon)
 {
-	return pivot_set_;
+  TRACE_SCOPE("Windmill::SelectLasso");
+
+  lasso_.resize(polygon.size());
+  for (size_t i = 0; i < polygon.size(); i++)
+    lasso_[i] = { polygon[i].x, polygon[i].y };
+
+  selection_.clear();
+  scene_.FindPointsInPolygon(lasso_, selection_);
+
+  SendSelection();
 }
 
 
-sf::Vector2f Windmill::getPivotPosition()
+void Windmill::ClearSelection()
 {
-	return current_pivot_.position;
+  if (selection_.empty())
+    return;
+
+  selection_.clear();
+  Push(SimCommand::Type::kClearSelection);
 }
 
 
-bool Windmill::CheckPointSide(Point& pt)
+bool Windmill::hasSelection() const
 {
-	float dy = (pt.position.y - current_pivot_.position.y);
-	float dx = (pt.position.x - current_pivot_.position.x);
+  return !selection_.empty();
+}
 
-	double angle;
 
-	if (dx < 0)
-	{
-		angle = std::atan(dy / dx) + M_PI;
-	}
-	else if (dx == 0)
-	{
-		angle = dy >= 0 ? M_PI_2 : 3 * M_PI_2;
-	}
-	else
-	{
-		angle = std::atan(dy / dx);
+void Windmill::SendSelection()
+{
+  SimCommand command(SimCommand::Type::kSetSelection);
+  command.ids = std::make_shared<std::vector<PointId>>(selection_);
+  sim_thread_.Push(command);
+
+  selection_version_ = (uint64_t)-1;
+}
 
-		if (angle < 0)
-			angle += M_PI * 2;
-	}
 
-	if (angle < M_PI)
-		return current_rad_ > angle && current_rad_ < angle + M_PI;
-	else
-		return current_rad_ > angle || current_rad_ < angle - M_PI;
+void Windmill::SyncSelection()
+{
+  const PointStore& points = scene_.getPoints();
+  if (selection_version_ == points.getVersion())
+    return;
+
+  selection_version_ = points.getVersion();
+
+  bool marked = selection_.size() <= max_marked_selection_;
+  selection_marks_.clear();
+
+  float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+  for (PointId id : selection_)
+  {
+    // points deleted one at a time since stay in the list, unseen
+    size_t slot = points.FindSlot(id);
+    if (slot == WindmillSim::no_slot_)
+      continue;
+
+    min_x = std::min(min_x, points.x(slot));
+    min_y = std::min(min_y, points.y(slot));
+    max_x = std::max(max_x, points.x(slot));
+    max_y = std::max(max_y, points.y(slot));
+
+    if (marked)
+      selection_marks_.append(sf::Vertex({ points.x(slot), points.y(slot) }, sf::Color(120, 200, 255)));
+  }
+
+  if (min_x > max_x)
+    selection_bounds_ = sf::FloatRect();
+  else
+    selection_bounds_ = sf::FloatRect(min_x, min_y, max_x - min_x, max_y - min_y);
 }
 
 
-void Windmill::UpdatePoints()
+void Windmill::DeleteSelection()
 {
-	for (auto& pt : points_)
-	{
-		if (pt == current_pivot_)
-			continue;
+  if (selection_.empty())
+    return;
+
+  TRACE_SCOPE("Windmill::DeleteSelection");
+
+  bool in_sync = point_renderer_.isInSync(scene_.getPoints());
+
+  scene_.DeletePoints(selection_, erased_slots_);
+  Push(SimCommand::Type::kDeleteSelection);
 
-		pt.prev_on_clockwise = pt.on_clockwise;
+  if (in_sync)
+    point_renderer_.Remove(scene_.getPoints(), erased_slots_);
 
-		pt.on_clockwise = CheckPointSide(pt);
-	}
+  if (hover_set_ && scene_.getPoints().FindSlot(hover_id_) == WindmillSim::no_slot_)
+    hover_set_ = false;
+
+  selection_.clear();
 }
 
 
-bool Windmill::CheckPointSwitches()
+void Windmill::TransformSelection(SimCommand::Type type, Vec2 position, double value, const Transform2& transform)
 {
-	for (auto& pt : points_)
-	{
-		if (pt == current_pivot_)
-			continue;
+  if (selection_.empty())
+    return;
+
+  TRACE_SCOPE("Windmill::TransformSelection");
 
-		if (pt.on_clockwise != pt.prev_on_clockwise)
-		{
-			if (SwitchPivot(pt))
-				return true;
-		}
-	}
+  bool in_sync = point_renderer_.isInSync(scene_.getPoints());
 
-	return false;
+  // the simulation builds the same transform from the command
+  scene_.TransformPoints(selection_, transform);
+  Push(type, position, 0, value);
+
+  if (in_sync)
+    point_renderer_.Move(scene_.getPoints(), selection_);
 }
 
 
-bool Windmill::SwitchPivot(Point& pt)
+void Windmill::TranslateSelection(sf::Vector2f offset)
 {
-	if (pt.index == prev_pivot_index_ && rad_since_pivot_ < 0.3f)
-		return false;
+  Vec2 by = { offset.x, offset.y };
 
-  bool in_vectors_ = false;
-  for (auto& v : vectors_)
-  {
-    if (v[0] == current_pivot_.position && v[1] == pt.position)
-    {
-      in_vectors_ = true;
-      break;
-    }
-  }
-  if (!in_vectors_)
-    vectors_.push_back(std::array<sf::Vector2f, 2>({ current_pivot_.position, pt.position }));
+  TransformSelection(SimCommand::Type::kTranslateSelection, by, 0.0, Transform2::Translation(by));
+}
 
-  prev_pivot_index_ = current_pivot_.index;
-	current_pivot_ = pt;
-	rad_since_pivot_ = 0;
 
-	return true;
+void Windmill::RotateSelection(double rad)
+{
+  SyncSelection();
+  Vec2 center = { selection_bounds_.left + selection_bounds_.width / 2.0f,
+                  selection_bounds_.top + selection_bounds_.height / 2.0f };
+
+  TransformSelection(SimCommand::Type::kRotateSelection, center, rad, Transform2::Rotation(center, rad));
 }
 
 
-void Windmill::AnimateSwitches(sf::RenderWindow& window, float circle_radius)
+void Windmill::ScaleSelection(double factor)
 {
-	for (auto& anim : animations_)
-	{
-		anim.Draw(window, circle_radius);
-	}
+  SyncSelection();
+  Vec2 center = { selection_bounds_.left + selection_bounds_.width / 2.0f,
+                  selection_bounds_.top + selection_bounds_.height / 2.0f };
+
+  TransformSelection(SimCommand::Type::kScaleSelection, center, factor, Transform2::Scaling(center, factor));
 }
 
 
-void Windmill::DrawVectors(sf::RenderWindow& window, sf::View& world_view)
+void Windmill::Hover(sf::Vector2f mouse_pos)
 {
-  for (auto it = vectors_.begin(); it != vectors_.end(); it++)
-  {
-    sf::Vector2f tail = (*it)[0], tip = (*it)[1];
+  size_t slot = scene_.FindPoint({ mouse_pos.x, mouse_pos.y }, pt_radius_ * 1.5f);
 
-    float length = sqrt(powf(tail.x - tip.x, 2) +
-      powf(tail.y - tip.y, 2));
+  hover_set_ = slot != WindmillSim::no_slot_;
+  if (hover_set_)
+    hover_id_ = scene_.getPoints().id(slot);
+}
 
-    double angle;
-    if (tip.x == tail.x)
-      angle = tip.y - tail.y > 0 ? M_PI_2 : 3 * M_PI_2;
-    else
-    {
-      angle = atan((tip.y - tail.y) / (tip.x - tail.x));
 
-      if (tip.x - tail.x < 0)
-        angle += M_PI;
-    }
+void Windmill::ClearHover()
+{
+  hover_set_ = false;
+}
 
-    Point::shaft.setPosition(tail);
 
-    Point::shaft.setRotation((float)(angle * 180.0 / M_PI));
+void Windmill::MultiplyAngularSpeed(double m_speed)
+{
+  Push(SimCommand::Type::kMultiplyAngularSpeed, { 0.0f, 0.0f }, 0, m_speed);
+}
 
-    Point::shaft.setScale(length,
-      2.0f * world_view.getSize().y / (float)window.getSize().y);
 
-    Point::arrowhead[0].position = tip;
+bool Windmill::isPivotSet()
+{
+	return sim_thread_.getSnapshot().pivot_set;
+}
 
-    Point::arrowhead[1].position = tip - Point::arrowhead_proportion * world_view.getSize().y *
-      sf::Vector2f((float)cos(angle + Point::arrow_angle), (float)sin(angle + Point::arrow_angle));
-    Point::arrowhead[2].position = tip - Point::arrowhead_proportion * world_view.getSize().y *
-      sf::Vector2f((float)cos(angle - Point::arrow_angle), (float)sin(angle - Point::arrow_angle));
 
-    auto color = getVectorColor((it - vectors_.begin()));
+bool Windmill::isStarted()
+{
+  return sim_thread_.getSnapshot().started;
+}
 
-    for (int i = 0; i < 3; i++)
-    {
-      Point::arrowhead[i].position -= (length / 2.0f - 1.5f * Point::arrowhead_proportion * 
-        world_view.getSize().y) * sf::Vector2f((float)cos(angle), (float)sin(angle));
-      Point::arrowhead[i].color = color;
-    }
-    Point::shaft.setFillColor(color);
 
-    window.draw(Point::arrowhead);
+bool Windmill::isAnimating()
+{
+  const SimSnapshot& snapshot = sim_thread_.getSnapshot();
+
+  return (snapshot.started && snapshot.pivot_set && !snapshot.paused) || sim_thread_.isBehind();
+}
+
+
+sf::Vector2f Windmill::getPivotPosition()
+{
+	return ToSf(sim_thread_.getSnapshot().pivot_position);
+}
+
+
+double Windmill::getTotalAngle()
+{
+  return sim_thread_.getSnapshot().total_angle;
+}
+
+
+void Windmill::AnimateSwitches(sf::RenderWindow& window, const sf::FloatRect& view_rect, float circle_radius)
+{
+  if (animations_.Draw(window, view_rect, circle_radius) > 0)
+    draw_stats_.draw_calls++;
+}
+
+
+void Windmill::DrawStatic(sf::RenderWindow& window, sf::View& world_view, float pixel_size, bool dense)
+{
+  TRACE_SCOPE("Windmill::DrawStatic");
 
-    window.draw(Point::shaft);
+  if (!dense)
+    point_renderer_.Sync(scene_.getPoints(), pt_radius_);
+
+  if (dense != layer_dense_)
+  {
+    layer_dense_ = dense;
+    static_layer_.Invalidate();
   }
+
+  // density maps are scaled to what's in view, so they can't be patched in
+  bool shiftable = !dense && short_arrows_.empty();
+
+  const std::vector<sf::FloatRect>& regions =
+    static_layer_.Begin(world_view, window.getSize(), scene_.getPoints().getVersion(),
+                        arrows_shown_ ? arrow_renderer_.getVersion() : (uint64_t)-1, shiftable);
+
+  if (!static_layer_.isAvailable())
+  {
+    sf::FloatRect view_rect(world_view.getCenter() - world_view.getSize() / 2.0f, world_view.getSize());
+    DrawScene(window, view_rect, pixel_size, dense);
+    return;
+  }
+
+  for (size_t i = 0; i < regions.size(); i++)
+    DrawScene(static_layer_.getTarget(i), regions[i], pixel_size, dense);
+
+  static_layer_.Draw(window);
+  draw_stats_.draw_calls++;
+}
+
+
+void Windmill::DrawScene(sf::RenderTarget& target, const sf::FloatRect& rect, float pixel_size, bool dense)
+{
+  if (arrows_shown_)
+  {
+    draw_stats_.arrows_drawn += arrow_renderer_.Draw(target, rect, pixel_size);
+    draw_stats_.draw_calls++;
+  }
+
+  DrawDensity(target, rect, pixel_size, dense);
+
+  // Draw the point circles in one call, the pivot's disc covers its ring
+  if (!dense)
+  {
+    draw_stats_.points_drawn += point_renderer_.Draw(target, scene_.getGrid(), rect);
+    draw_stats_.draw_calls++;
+  }
+}
+
+
+bool Windmill::isDense(const sf::FloatRect& view_rect, float pixel_size) const
+{
+  const DensityPyramid& density = scene_.getDensity();
+
+  // too coarse a pyramid would show as blocks rather than dots
+  if (density.size() == 0 || density.getCellSize(0) > DensityRenderer::getTexelSize(pixel_size))
+    return false;
+
+  float pixels = view_rect.width * view_rect.height / (pixel_size * pixel_size);
+  size_t in_view = density.CountRect(view_rect.left, view_rect.top, 
+                                     view_rect.left + view_rect.width, view_rect.top + view_rect.height);
+
+  return in_view > density_points_per_pixel_ * pixels;
 }
 
 
-sf::Color Windmill::getVectorColor(unsigned i)
+void Windmill::DrawDensity(sf::RenderTarget& target, const sf::FloatRect& view_rect, float pixel_size, bool dense)
 {
-  size_t s = vectors_.size();
-  float t = s != 1 ? (float)i / (s-1) : 0;
-  return sf::Color((int)(30 * t), (int)(90 * t), (int)(90 * (1.0f - t)));
+  TRACE_SCOPE("Windmill::DrawDensity");
+
+  if (!dense && short_arrows_.empty())
+    return;
+
+  if (density_renderer_.Begin(view_rect, pixel_size, 
+                              dense ? scene_.getPoints().getVersion() : (uint64_t)-1,
+                              arrows_shown_ ? arrow_renderer_.getVersion() : (uint64_t)-1))
+  {
+    if (dense)
+      density_renderer_.Accumulate(scene_.getDensity(), DensityRenderer::Layer::kPoints);
+
+    for (const DensityPyramid* arrows : short_arrows_)
+      density_renderer_.Accumulate(*arrows, DensityRenderer::Layer::kArrows);
+  }
+
+  density_renderer_.Draw(target);
+  draw_stats_.draw_calls++;
 }
 
 
 void Windmill::toggleArrows()
 {
   arrows_shown_ = !arrows_shown_;
-}
\ No newline at end of file
+}
+
+
+void Windmill::toggleEngine()
+{
+  Push(SimCommand::Type::kToggleEngine);
+}
+
+
+void Windmill::CompletePath()
+{
+  Push(SimCommand::Type::kCompletePath);
+}
+
+
+void Windmill::SeekTo(double total_angle)
+{
+  Push(SimCommand::Type::kSeekTo, { 0.0f, 0.0f }, 0, total_angle);
+  animations_.Clear();
+}
+
+
+void Windmill::PrecomputeTransitions()
+{
+  Push(SimCommand::Type::kPrecomputeTransitions);
+}
+
+
+const DrawStats& Windmill::getDrawStats() const
+{
+  return draw_stats_;
+}
+
+
+size_t Windmill::getFrameSwitches() const
+{
+  return frame_switches_;
+}
@@ -11,96 +11,125 @@
 #include <SFML/Audio.hpp>
 
 #include "SwitchAnimation.h"
+#include "WindmillSim.h"
+#include "PointScene.h"
+#include "SimThread.h"
+#include "PointRenderer.h"
+#include "ArrowRenderer.h"
+#include "DensityRenderer.h"
+#include "StaticLayer.h"
+
+// What one call to Windmill::Draw sent to the window
+struct DrawStats
+{
+  unsigned draw_calls;
+  size_t points_drawn;
+  size_t arrows_drawn;
+};
 
-struct Point
+// The windmill on screen. The simulation runs on a SimThread; what's drawn
+// comes from its latest snapshot, apart from the points, which the UI keeps
+// its own copy of since only its own commands change them.
+class Windmill
 {
 private:
 
-  static unsigned index_count;
-
-public:
-
-  static float arrowhead_proportion;
-  static double arrow_angle;
+  static float arrowhead_proportion_;
+  static const float density_points_per_pixel_;
+  static const size_t max_marked_selection_;
 
-  static sf::RectangleShape shaft;
-  static sf::VertexArray arrowhead;
+  SimThread sim_thread_;
 
-	sf::Vector2f position;
+  // the points as the UI has left them, ids and positions with the grid and
+  // pyramid picking, hovering and drawing go through; the simulation thread
+  // keeps no grid or pyramid of its own
+  PointScene scene_;
 
-	bool on_clockwise = false;
-	bool prev_on_clockwise = false;
+  // how far the snapshots have brought the path; its edges go straight to
+  // arrow_renderer_ with their ends taken from the slots of scene_
+  uint64_t path_generation_;
+  size_t edge_count_;
 
-  unsigned index;
+  uint64_t snapshot_sequence_;
+  uint64_t switch_total_;
 
-  Point(sf::Vector2f position = { 100000000.0f, 100000000.0f });
+	float pt_proportion_size_;
 
-	bool operator==(Point& other)
-	{
-    return index == other.index;
-	}
+	float pt_radius_;
+	sf::CircleShape pt_pivot_shape_;
 
-  bool operator!=(Point& other)
-  {
-    return index != other.index;
-  }
+  PointRenderer point_renderer_;
 
-  unsigned getIndexCount();
+  // where the points of the last deletion were, for the renderer to follow
+  std::vector<size_t> erased_slots_;
 
-};
-
-class Windmill
-{
-private:
+  // ring around the point under the mouse
+  sf::CircleShape hover_shape_;
+  PointId hover_id_;
+  bool hover_set_;
 
-	static const double default_angular_speed_;
+  sf::RectangleShape line_shape_;
 
-	std::vector<Point> points_;
-  std::vector<std::array<sf::Vector2f, 2>> vectors_;
+  // selected points by id; the simulation thread keeps the same list, so
+  // deleting or moving them takes one command
+  std::vector<PointId> selection_;
+  std::vector<Vec2> lasso_;
+  sf::FloatRect selection_bounds_;
+  sf::RectangleShape selection_box_;
+  sf::VertexArray selection_marks_;
+  uint64_t selection_version_;
 
-	Point current_pivot_;
-  unsigned prev_pivot_index_;
+  ArrowRenderer arrow_renderer_;
 
-	bool pivot_set_;
-	double rad_since_pivot_;
+  // stands in for the points when zoomed far out, and for arrows shorter
+  // than a pixel
+  DensityRenderer density_renderer_;
+  std::vector<const DensityPyramid*> short_arrows_;
 
-	double current_rad_;
-	double rads_per_second_;
+  // the arrows and points, drawn again only when they or the view change
+  StaticLayer static_layer_;
+  bool layer_dense_;
 
-	float pt_proportion_size_;
+	sf::Sound click_sound_;
 
-	sf::CircleShape pt_shape_;
-	sf::CircleShape pt_pivot_shape_;
+	SwitchAnimationPool animations_;
 
-  sf::RectangleShape line_shape_;
+  bool arrows_shown_;
 
-	sf::Sound click_sound_;
+  DrawStats draw_stats_;
+  size_t frame_switches_;
 
-	std::vector<SwitchAnimation> animations_;
 
-	bool paused_;
-	bool started_;
+  void UpdateLine();
 
-  bool arrows_shown_;
+  // Takes over the path and switches of a fresh snapshot
+  void ApplySnapshot();
 
+  void Push(SimCommand::Type type, Vec2 position = { 0.0f, 0.0f }, PointId id = 0, double value = 0.0);
 
-  void UpdateLine(float dt, float length);
+  void UpdatePointSize(sf::RenderWindow& window, sf::View& world_view);
 
-  bool CheckPointSide(Point& pt);
+  // Sends the new selection_ to the simulation thread
+  void SendSelection();
 
-  void UpdatePoints();
+  // Brings the bounds and marks up to date with the points
+  void SyncSelection();
 
-  void UpdatePointSize(sf::RenderWindow& window, sf::View& world_view);
+  // Applies the transform here and the matching command there
+  void TransformSelection(SimCommand::Type type, Vec2 position, double value, const Transform2& transform);
 
-  bool CheckPointSwitches();
+  void AnimateSwitches(sf::RenderWindow& window, const sf::FloatRect& view_rect, float circle_radius);
 
-  bool SwitchPivot(Point& pt);
+  // Brings the static layer up to date and lays it under the rest
+  void DrawStatic(sf::RenderWindow& window, sf::View& world_view, float pixel_size, bool dense);
 
-  void AnimateSwitches(sf::RenderWindow& window, float circle_radius);
+  // The arrows, density map and points that intersect rect
+  void DrawScene(sf::RenderTarget& target, const sf::FloatRect& rect, float pixel_size, bool dense);
 
-  void DrawVectors(sf::RenderWindow& window, sf::View& world_view);
+  // Whether the points in view are packed too densely to draw one by one
+  bool isDense(const sf::FloatRect& view_rect, float pixel_size) const;
 
-  sf::Color getVectorColor(unsigned i);
+  void DrawDensity(sf::RenderTarget& target, const sf::FloatRect& view_rect, float pixel_size, bool dense);
 
 public:
   
@@ -120,17 +149,64 @@ public:
 
 	void AddPoint(sf::Vector2f pos);
 
+  void AddPoints(const sf::Vector2f* positions, size_t count);
+
 	bool ChoosePivot(sf::Vector2f click_pos);
 
 	void TryDelete(sf::Vector2f click_pos);
 
+  // Selects the points inside the rectangle, in world coordinates, in place
+  // of the ones selected before
+  void SelectRect(const sf::FloatRect& rect);
+
+  // Selects the points inside the polygon in place of the ones before
+  void SelectLasso(const std::vector<sf::Vector2f>& polygon);
+
+  void ClearSelection();
+
+  bool hasSelection() const;
+
+  void DeleteSelection();
+
+  void TranslateSelection(sf::Vector2f offset);
+
+  // About the centre of the selection's bounding box
+  void RotateSelection(double rad);
+
+  void ScaleSelection(double factor);
+
+  // Highlights the point under the mouse, if any
+  void Hover(sf::Vector2f mouse_pos);
+
+  void ClearHover();
+
 	void MultiplyAngularSpeed(double m_speed);
 
 	bool isPivotSet();
 
+  bool isStarted();
+
+  // Whether the line is turning or commands are still on their way, so
+  // every frame has to be drawn
+  bool isAnimating();
+
 	sf::Vector2f getPivotPosition();
 
+  double getTotalAngle();
+
   void toggleArrows();
 
-};
+  void toggleEngine();
+
+  void CompletePath();
 
+  void SeekTo(double total_angle);
+
+  void PrecomputeTransitions();
+
+  const DrawStats& getDrawStats() const;
+
+  // switches during the last call to Update
+  size_t getFrameSwitches() const;
+
+};
@@ -0,0 +1,704 @@
+#include "WindmillSim.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "SideKernel.h"
+#include "Trace.h"
+
+
+const size_t WindmillSim::no_slot_ = (size_t)(-1);
+
+const double WindmillSim::default_angular_speed_ = 0.45;
+
+const double WindmillSim::max_angular_speed_ = 100.0;
+
+const double WindmillSim::max_sweep_rad_ = M_PI_2;
+
+const double WindmillSim::switch_epsilon_ = 1e-9;
+
+const size_t WindmillSim::default_angle_index_budget_ = 64u << 20;
+
+const size_t WindmillSim::max_timeline_events_ = 1u << 22;
+
+const size_t WindmillSim::transition_table_budget_ = (size_t)1u << 30;
+
+WindmillSim::WindmillSim()
+	: points_()
+  , path_()
+  , path_generation_(0)
+  , pivot_id_(PointStore::no_id_)
+  , prev_pivot_id_(PointStore::no_id_)
+	, pivot_set_(false)
+  , rad_since_pivot_(0.0)
+	, current_rad_(0.0)
+  , total_rad_(0.0)
+	, rads_per_second_(default_angular_speed_)
+	, paused_(false)
+	, started_(false)
+  , engine_(Engine::kEventDriven)
+  , angle_index_(default_angle_index_budget_)
+  , timeline_(points_, angle_index_, transition_table_, switch_epsilon_, max_timeline_events_)
+  , next_switch_dirty_(true)
+  , timeline_pos_(0)
+  , next_pivot_slot_(no_slot_)
+  , rad_to_next_switch_(0.0)
+{
+}
+
+
+void WindmillSim::Start()
+{
+  if (points_.empty())
+    return;
+
+	if (!pivot_set_)
+	{
+    pivot_id_ = points_.id(points_.size() - 1);
+		pivot_set_ = true;
+	}
+
+	started_ = true;
+  total_rad_ = 0.0;
+
+	UpdatePoints(current_rad_);
+	prev_pivot_id_ = pivot_id_;
+  InvalidateSwitches();
+}
+
+
+void WindmillSim::TogglePause()
+{
+	paused_ = !paused_;
+}
+
+
+void WindmillSim::Restart()
+{
+	points_.Clear();
+  ClearPath();
+  switches_.clear();
+  angle_index_.Clear();
+  transition_table_.Clear();
+
+	started_ = false;
+	pivot_set_ = false;
+	paused_ = false;
+	rads_per_second_ = default_angular_speed_;
+	current_rad_ = 0;
+  total_rad_ = 0.0;
+  InvalidateSwitches();
+}
+
+
+void WindmillSim::AdvanceLine(double rad)
+{
+	current_rad_ += rad;
+	rad_since_pivot_ += rad;
+  total_rad_ += rad;
+
+	if (current_rad_ >= 2 * M_PI)
+		current_rad_ -= 2 * M_PI;
+}
+
+
+void WindmillSim::Update(double dt)
+{
+  if (paused_)
+  {
+    switches_.clear();
+    return;
+  }
+
+  Advance(rads_per_second_ * dt);
+}
+
+
+void WindmillSim::Advance(double rad)
+{
+  TRACE_SCOPE("WindmillSim::Advance");
+
+  switches_.clear();
+
+	if (!started_ || !pivot_set_)
+		return;
+
+  if (engine_ == Engine::kEventDriven)
+    AdvanceEventDriven(rad);
+  else
+    AdvanceFrameStepped(rad);
+}
+
+
+void WindmillSim::AdvanceFrameStepped(double rad)
+{
+  double remaining = rad;
+
+  while (remaining > 0.0)
+  {
+    // sweeps shorter than half a turn cross each point at most once
+    double sweep = std::min(remaining, max_sweep_rad_);
+
+    UpdatePoints(current_rad_ + sweep);
+
+    double swept;
+    if (CheckPointSwitches(sweep, swept))
+    {
+      switches_.push_back((unsigned)getPivotSlot());
+
+      // the rest of the sweep turns around the new pivot
+      UpdatePoints(current_rad_);
+      remaining -= swept;
+    }
+    else
+    {
+      AdvanceLine(sweep - swept);
+      remaining -= sweep;
+    }
+  }
+}
+
+
+void WindmillSim::AdvanceEventDriven(double rad)
+{
+  if (next_switch_dirty_)
+    FindNextSwitch();
+
+  double step = rad;
+
+  // jump from switch to switch, so nothing is scanned between events
+  while (next_pivot_slot_ != no_slot_ && rad_to_next_switch_ <= step)
+  {
+    step -= rad_to_next_switch_;
+    JumpToNextSwitch();
+
+    switches_.push_back((unsigned)getPivotSlot());
+  }
+
+  AdvanceLine(step);
+  rad_to_next_switch_ -= step;
+}
+
+
+void WindmillSim::ResetTimeline()
+{
+  next_switch_dirty_ = false;
+
+  timeline_.Reset((unsigned)getPivotSlot(), current_rad_, total_rad_);
+  timeline_pos_ = 0;
+}
+
+
+void WindmillSim::FindNextSwitch()
+{
+  if (next_switch_dirty_)
+    ResetTimeline();
+
+  next_pivot_slot_ = no_slot_;
+
+  if (!pivot_set_)
+    return;
+
+  SwitchEvent e;
+  if (timeline_.getEvent(timeline_pos_, e))
+  {
+    next_pivot_slot_ = e.slot;
+    rad_to_next_switch_ = e.rad - total_rad_;
+  }
+}
+
+
+void WindmillSim::JumpToNextSwitch()
+{
+  AdvanceLine(rad_to_next_switch_);
+  SetPivot(next_pivot_slot_);
+  timeline_pos_++;
+
+  FindNextSwitch();
+}
+
+
+void WindmillSim::InvalidateSwitches()
+{
+  next_switch_dirty_ = true;
+}
+
+
+void WindmillSim::ClearPath()
+{
+  path_.Clear();
+  path_generation_++;
+}
+
+
+void WindmillSim::RebuildPath(size_t event_count)
+{
+  ClearPath();
+
+  size_t from = timeline_.getOriginSlot();
+  for (size_t i = 0; i < event_count && i < timeline_.getRecordedCount(); i++)
+  {
+    size_t to = timeline_.getRecorded(i).slot;
+
+    path_.Visit((uint32_t)from, (uint32_t)to);
+    from = to;
+  }
+}
+
+
+PointId WindmillSim::AddPoint(Vec2 pos)
+{
+  AddPoints(&pos, 1);
+
+  return points_.id(points_.size() - 1);
+}
+
+
+void WindmillSim::AddPoints(const Vec2* positions, size_t count)
+{
+  TRACE_SCOPE("WindmillSim::AddPoints");
+
+  if (count == 0)
+    return;
+
+  size_t first = points_.size();
+
+  for (size_t i = 0; i < count; i++)
+    points_.Add(positions[i].x, positions[i].y);
+
+	if (started_ && pivot_set_)
+	{
+    for (size_t slot = first; slot < points_.size(); slot++)
+      points_.setSide(slot, CheckPointSide(slot));
+	}
+
+  // whatever was worked out for the old points is dropped once per batch
+  ClearPath();
+  angle_index_.Clear();
+  transition_table_.Clear();
+  InvalidateSwitches();
+}
+
+
+void WindmillSim::AddPoints(const std::vector<Vec2>& positions)
+{
+  AddPoints(positions.data(), positions.size());
+}
+
+
+void WindmillSim::ChoosePivot(size_t slot)
+{
+  pivot_id_ = points_.id(slot);
+	pivot_set_ = true;
+	UpdatePoints(current_rad_);
+
+  ClearPath();
+  InvalidateSwitches();
+}
+
+
+void WindmillSim::DeletePoint(size_t slot)
+{
+  PointId id = points_.id(slot);
+  DeletePoints(&id, 1);
+}
+
+
+void WindmillSim::DeletePoints(const PointId* ids, size_t count)
+{
+  TRACE_SCOPE("WindmillSim::DeletePoints");
+
+  bool any = false;
+
+  for (size_t i = 0; i < count; i++)
+  {
+    size_t slot = points_.FindSlot(ids[i]);
+    if (slot == no_slot_)
+      continue;
+
+    if (pivot_set_ && ids[i] == pivot_id_)
+      pivot_set_ = started_ = false;
+
+    points_.Erase(slot);
+    any = true;
+  }
+
+  if (!any)
+    return;
+
+  ClearPath();
+  angle_index_.Clear();
+  transition_table_.Clear();
+  InvalidateSwitches();
+}
+
+
+void WindmillSim::DeletePoints(const std::vector<PointId>& ids)
+{
+  DeletePoints(ids.data(), ids.size());
+}
+
+
+void WindmillSim::TransformPoints(const std::vector<PointId>& ids, const Transform2& transform)
+{
+  TRACE_SCOPE("WindmillSim::TransformPoints");
+
+  bool any = false;
+
+  for (PointId id : ids)
+  {
+    size_t slot = points_.FindSlot(id);
+    if (slot == no_slot_)
+      continue;
+
+    Vec2 to = transform.Apply({ points_.x(slot), points_.y(slot) });
+    points_.setPosition(slot, to.x, to.y);
+    any = true;
+  }
+
+  if (!any)
+    return;
+
+  // the pivot may have moved too, so every side is taken again
+	if (started_ && pivot_set_)
+    UpdatePoints(current_rad_);
+
+  ClearPath();
+  angle_index_.Clear();
+  transition_table_.Clear();
+  InvalidateSwitches();
+}
+
+
+void WindmillSim::MultiplyAngularSpeed(double m_speed)
+{
+	rads_per_second_ *= m_speed;
+
+	if (rads_per_second_ < 0.001)
+		rads_per_second_ = 0.001;
+	else if (rads_per_second_ > max_angular_speed_)
+		rads_per_second_ = max_angular_speed_;
+}
+
+
+bool WindmillSim::CheckPointSide(size_t slot)
+{
+  Vec2 pivot = getPivotPosition();
+
+	float dx = (points_.x(slot) - pivot.x);
+	float dy = (points_.y(slot) - pivot.y);
+
+  // sign of the cross product between the line's direction and the point
+	return (float)std::sin(current_rad_) * dx - (float)std::cos(current_rad_) * dy > 0.0f;
+}
+
+
+void WindmillSim::UpdatePoints(double rad)
+{
+  size_t pivot = getPivotSlot();
+  if (pivot == no_slot_)
+    return;
+
+  points_.ClassifySides(points_.x(pivot), points_.y(pivot), rad);
+
+  // the pivot sits on the line, so its side is meaningless
+  points_.clearChanged(pivot);
+}
+
+
+bool WindmillSim::CheckPointSwitches(double sweep, double& swept)
+{
+  const auto& changed = points_.getChanged();
+  Vec2 pivot = getPivotPosition();
+
+  crossings_.clear();
+
+	for (size_t w = 0; w < changed.size(); w++)
+	{
+    for (uint64_t bits = changed[w]; bits != 0; bits &= bits - 1)
+    {
+      size_t slot = w * 64 + CountTrailingZeros(bits);
+
+      double angle = std::atan2((double)points_.y(slot) - pivot.y,
+                                (double)points_.x(slot) - pivot.x);
+      double delta = AngleIndex::ToHalfTurn(angle - current_rad_);
+
+      // points right on the line at either end of the sweep only flip from rounding
+      if (delta > sweep)
+      {
+        if (delta - sweep > 1e-6)
+          continue;
+        delta = sweep;
+      }
+      if (delta < switch_epsilon_)
+        continue;
+
+      crossings_.push_back({ delta, (unsigned)slot });
+    }
+	}
+
+  std::sort(crossings_.begin(), crossings_.end(),
+            [](const AngleEntry& a, const AngleEntry& b)
+            {
+              return a.angle < b.angle;
+            });
+
+  // walk the line up to each crossing in the order the line reaches them
+  swept = 0.0;
+  for (auto& crossing : crossings_)
+  {
+    AdvanceLine(crossing.angle - swept);
+    swept = crossing.angle;
+
+    if (SwitchPivot(crossing.slot))
+      return true;
+  }
+
+	return false;
+}
+
+
+bool WindmillSim::SwitchPivot(size_t slot)
+{
+	if (points_.id(slot) == prev_pivot_id_ && rad_since_pivot_ < 0.3f)
+		return false;
+
+  SetPivot(slot);
+
+	return true;
+}
+
+
+void WindmillSim::SetPivot(size_t slot)
+{
+  PointId id = points_.id(slot);
+
+  path_.Visit((uint32_t)points_.FindSlot(pivot_id_), (uint32_t)slot);
+
+  prev_pivot_id_ = pivot_id_;
+  pivot_id_ = id;
+	rad_since_pivot_ = 0;
+}
+
+
+void WindmillSim::toggleEngine()
+{
+  setEngine(engine_ == Engine::kEventDriven ? Engine::kFrameStepped : Engine::kEventDriven);
+}
+
+
+void WindmillSim::setEngine(Engine engine)
+{
+  engine_ = engine;
+
+  if (engine_ == Engine::kFrameStepped)
+  {
+    // resync the sides so no stale switch fires on the first frame
+    if (started_ && pivot_set_)
+    {
+      UpdatePoints(current_rad_);
+    }
+  }
+  else
+  {
+    InvalidateSwitches();
+  }
+}
+
+
+void WindmillSim::CompletePath()
+{
+  TRACE_SCOPE("WindmillSim::CompletePath");
+
+  if (!pivot_set_ || points_.size() < 2)
+    return;
+
+  if (next_switch_dirty_)
+  {
+    ResetTimeline();
+    FindNextSwitch();
+  }
+
+  // compute ahead until the switches repeat and show every arrow on the way
+  timeline_.FindPeriod();
+  RebuildPath(timeline_.getRecordedCount());
+}
+
+
+void WindmillSim::SeekTo(double total_angle)
+{
+  TRACE_SCOPE("WindmillSim::SeekTo");
+
+  if (!started_ || !pivot_set_)
+    return;
+
+  if (next_switch_dirty_)
+    ResetTimeline();
+
+  total_angle = std::max(total_angle, timeline_.getOriginTotal());
+
+  size_t count = timeline_.CountBefore(total_angle);
+
+  SwitchEvent last = { timeline_.getOriginSlot(), timeline_.getOriginTotal() };
+  if (count > 0)
+    timeline_.getEvent(count - 1, last);
+
+  if (count > 0)
+  {
+    SwitchEvent before = { timeline_.getOriginSlot(), timeline_.getOriginTotal() };
+    if (count > 1)
+      timeline_.getEvent(count - 2, before);
+
+    prev_pivot_id_ = points_.id(before.slot);
+  }
+  else
+  {
+    // back at the origin there is no step to return along, as after Start
+    prev_pivot_id_ = points_.id(last.slot);
+  }
+
+  pivot_id_ = points_.id(last.slot);
+  rad_since_pivot_ = total_angle - last.rad;
+
+  total_rad_ = total_angle;
+  current_rad_ = std::fmod(timeline_.getOriginRad() + (total_angle - timeline_.getOriginTotal()), 2 * M_PI);
+
+  timeline_pos_ = count;
+  FindNextSwitch();
+
+  RebuildPath(count);
+  switches_.clear();
+
+  if (engine_ == Engine::kFrameStepped)
+    UpdatePoints(current_rad_);
+}
+
+
+bool WindmillSim::PrecomputeTransitions()
+{
+  TRACE_SCOPE("WindmillSim::PrecomputeTransitions");
+
+  TransitionTable table;
+  if (!BuildTransitions(points_, table))
+    return false;
+
+  return AdoptTransitions(std::move(table), points_.getVersion());
+}
+
+
+bool WindmillSim::BuildTransitions(const PointStore& points, TransitionTable& table)
+{
+  return table.Build(points, std::thread::hardware_concurrency(), transition_table_budget_);
+}
+
+
+bool WindmillSim::AdoptTransitions(TransitionTable&& table, uint64_t points_version)
+{
+  if (!table.isBuilt() || points_version != points_.getVersion())
+    return false;
+
+  transition_table_ = std::move(table);
+
+  // the table answers every lookup the cached orders did
+  angle_index_.Clear();
+  return true;
+}
+
+
+void WindmillSim::setAngleIndexBudget(size_t bytes)
+{
+  angle_index_.setMemoryBudget(bytes);
+}
+
+
+bool WindmillSim::isPivotSet() const
+{
+	return pivot_set_;
+}
+
+
+bool WindmillSim::isStarted() const
+{
+  return started_;
+}
+
+
+bool WindmillSim::isPaused() const
+{
+  return paused_;
+}
+
+
+WindmillSim::Engine WindmillSim::getEngine() const
+{
+  return engine_;
+}
+
+
+Vec2 WindmillSim::getPivotPosition() const
+{
+  size_t slot = getPivotSlot();
+  if (slot == no_slot_)
+    return { 100000000.0f, 100000000.0f }; // far out of view
+
+	return { points_.x(slot), points_.y(slot) };
+}
+
+
+size_t WindmillSim::getPivotSlot() const
+{
+  return pivot_set_ ? points_.FindSlot(pivot_id_) : no_slot_;
+}
+
+
+PointId WindmillSim::getPivotId() const
+{
+  return pivot_id_;
+}
+
+
+double WindmillSim::getLineAngle() const
+{
+  return current_rad_;
+}
+
+
+double WindmillSim::getTotalAngle() const
+{
+  return total_rad_;
+}
+
+
+const PointStore& WindmillSim::getPoints() const
+{
+  return points_;
+}
+
+
+const EdgeSet& WindmillSim::getPath() const
+{
+  return path_;
+}
+
+
+uint64_t WindmillSim::getPathGeneration() const
+{
+  return path_generation_;
+}
+
+
+const std::vector<unsigned>& WindmillSim::getSwitches() const
+{
+  return switches_;
+}
+
+
+size_t WindmillSim::getMemoryUsed() const
+{
+  return points_.getMemoryUsed() + 
+         path_.getMemoryUsed() + 
+         crossings_.capacity() * sizeof(AngleEntry) + 
+         angle_index_.getMemoryUsed() + 
+         transition_table_.getMemoryUsed() + 
+         timeline_.getMemoryUsed();
+}
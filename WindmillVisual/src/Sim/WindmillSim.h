@@ -0,0 +1,198 @@
+#pragma once
+
+#define _USE_MATH_DEFINES
+
+#include <vector>
+#include <math.h>
+
+#include "Vec2.h"
+#include "AngleIndex.h"
+#include "PointStore.h"
+#include "EdgeSet.h"
+#include "SwitchTimeline.h"
+#include "TransitionTable.h"
+
+// The windmill process itself: points, pivot, line angle, switches and the
+// path the pivot takes. Has no dependency on SFML, so it can run headless.
+class WindmillSim
+{
+public:
+
+  enum class Engine
+  {
+    kFrameStepped, // rescans every point each frame
+    kEventDriven   // jumps straight to the next analytically computed switch
+  };
+
+  static const size_t no_slot_;
+
+private:
+
+	static const double default_angular_speed_;
+  static const double max_angular_speed_;
+  static const double max_sweep_rad_;
+  static const double switch_epsilon_;
+  static const size_t default_angle_index_budget_;
+  static const size_t max_timeline_events_;
+  static const size_t transition_table_budget_;
+
+	PointStore points_;
+  EdgeSet path_;
+  uint64_t path_generation_;
+
+  // by id, so they stay put when slots move
+  PointId pivot_id_;
+  PointId prev_pivot_id_;
+
+	bool pivot_set_;
+	double rad_since_pivot_;
+
+	double current_rad_;
+  double total_rad_;
+	double rads_per_second_;
+
+	bool paused_;
+	bool started_;
+
+  Engine engine_;
+
+  // slots that became pivot during the last update
+  std::vector<unsigned> switches_;
+
+  AngleIndex angle_index_;
+  TransitionTable transition_table_;
+
+  // switches ahead of the event driven engine, restarted from the current
+  // state when dirty
+  SwitchTimeline timeline_;
+  bool next_switch_dirty_;
+  size_t timeline_pos_;
+  size_t next_pivot_slot_;
+  double rad_to_next_switch_;
+
+  // side changes found in one sweep of the frame stepped engine
+  std::vector<AngleEntry> crossings_;
+
+  // times the private stages of a frame
+  friend class SimBenchmark;
+
+
+  void AdvanceLine(double rad);
+
+  void AdvanceFrameStepped(double rad);
+
+  void AdvanceEventDriven(double rad);
+
+  void ResetTimeline();
+
+  void FindNextSwitch();
+
+  void JumpToNextSwitch();
+
+  void InvalidateSwitches();
+
+  void ClearPath();
+
+  void RebuildPath(size_t event_count);
+
+  bool CheckPointSide(size_t slot);
+
+  void UpdatePoints(double rad);
+
+  bool CheckPointSwitches(double sweep, double& swept);
+
+  bool SwitchPivot(size_t slot);
+
+  void SetPivot(size_t slot);
+
+
+public:
+
+  WindmillSim();
+
+	void Start();
+
+	void TogglePause();
+
+	void Restart();
+
+	void Update(double dt);
+
+  void Advance(double rad);
+
+  // Returns the new point's id
+	PointId AddPoint(Vec2 pos);
+
+  // Adds the points as one batch, so the path and caches are cleared once
+  // rather than per point. They take the last count slots
+  void AddPoints(const Vec2* positions, size_t count);
+
+  void AddPoints(const std::vector<Vec2>& positions);
+
+	void ChoosePivot(size_t slot);
+
+	void DeletePoint(size_t slot);
+
+  // Deletes the points as one batch, like AddPoints. Stale ids are skipped
+  void DeletePoints(const PointId* ids, size_t count);
+
+  void DeletePoints(const std::vector<PointId>& ids);
+
+  // Moves the points as one batch, each id once. They keep their slots and ids
+  void TransformPoints(const std::vector<PointId>& ids, const Transform2& transform);
+
+	void MultiplyAngularSpeed(double m_speed);
+
+  void toggleEngine();
+
+  void setEngine(Engine engine);
+
+  void CompletePath();
+
+  void SeekTo(double total_angle);
+
+  // Builds the transition table here and now
+  bool PrecomputeTransitions();
+
+  // Builds a transition table for the points, e.g. on another thread from a
+  // copy of them. Returns false if it would not fit in memory
+  static bool BuildTransitions(const PointStore& points, TransitionTable& table);
+
+  // Takes a table built from the points as they were at points_version, and
+  // drops it if they have changed since. Returns true if it was taken
+  bool AdoptTransitions(TransitionTable&& table, uint64_t points_version);
+
+  void setAngleIndexBudget(size_t bytes);
+
+	bool isPivotSet() const;
+
+  bool isStarted() const;
+
+  bool isPaused() const;
+
+  Engine getEngine() const;
+
+  Vec2 getPivotPosition() const;
+
+  // no_slot_ when there's no pivot
+  size_t getPivotSlot() const;
+
+  PointId getPivotId() const;
+
+  double getLineAngle() const;
+
+  double getTotalAngle() const;
+
+  const PointStore& getPoints() const;
+
+  // Every distinct step the pivot took, by slot, and how often
+  const EdgeSet& getPath() const;
+
+  // Changes whenever the path is cleared, between those it only grows
+  uint64_t getPathGeneration() const;
+
+  const std::vector<unsigned>& getSwitches() const;
+
+  size_t getMemoryUsed() const;
+
+};
@@ -0,0 +1,392 @@
+// Benchmarks for the windmill simulation. Times the stages of a frame
+// (CheckPointSide, UpdatePoints, CheckPointSwitches, SwitchPivot) and whole
+// Update loops of both engines, for a range of point counts and
+// distributions.
+//
+//   windmill_bench [--sizes 10,1000,...] [--max N] [--dist NAME] [--budget SEC] [--seed S]
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__unix__)
+#include <sys/resource.h>
+#endif
+
+#include "../Sim/WindmillSim.h"
+
+
+enum class Distribution
+{
+  kUniform,   // uniform over a square
+  kClustered, // gaussian blobs
+  kCollinear, // a thin band along a line
+  kCircle     // on the boundary of a circle
+};
+
+static const char* distribution_names[] = { "uniform", "clustered", "collinear", "circle" };
+
+
+struct StageResult
+{
+  double ns_per_point;
+  double ns_per_call;
+  double switches_per_sec; // negative when it doesn't apply
+};
+
+
+class SimBenchmark
+{
+private:
+
+  typedef std::chrono::steady_clock Clock;
+
+  // crossings a frame should contain on average, so frames stay comparable
+  // across point counts
+  static const double crossings_per_frame_;
+
+  double budget_;
+  std::mt19937 rng_;
+
+  static double Seconds(Clock::time_point begin, Clock::time_point end)
+  {
+    return std::chrono::duration<double>(end - begin).count();
+  }
+
+  // Runs f in batches until the budget is spent and returns the seconds per call
+  template <typename F>
+  double TimePerCall(size_t batch, F f)
+  {
+    size_t calls = 0;
+    double elapsed = 0.0;
+
+    auto begin = Clock::now();
+    do
+    {
+      for (size_t i = 0; i < batch; i++)
+        f();
+      calls += batch;
+      elapsed = Seconds(begin, Clock::now());
+    } while (elapsed < budget_);
+
+    return elapsed / calls;
+  }
+
+  static size_t BatchFor(size_t point_count)
+  {
+    return std::max<size_t>(1, 100000 / point_count);
+  }
+
+  static double getFrameRad(const WindmillSim& sim)
+  {
+    return crossings_per_frame_ * M_PI / sim.points_.size();
+  }
+
+  static void Reset(WindmillSim& sim, WindmillSim::Engine engine)
+  {
+    sim.ClearPath();
+    sim.setEngine(engine);
+    sim.ChoosePivot(0);
+    sim.Start();
+  }
+
+public:
+
+  SimBenchmark(double budget, unsigned seed)
+    : budget_(budget)
+    , rng_(seed)
+  {
+  }
+
+  void Fill(WindmillSim& sim, Distribution distribution, size_t count)
+  {
+    std::uniform_real_distribution<float> coord(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<double> turn(0.0, 2 * M_PI);
+    std::normal_distribution<float> spread(0.0f, 20.0f);
+    std::normal_distribution<float> jitter(0.0f, 0.5f);
+
+    std::vector<Vec2> centers(16);
+    for (auto& c : centers)
+      c = { coord(rng_), coord(rng_) };
+
+    std::vector<Vec2> positions;
+    positions.reserve(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+      switch (distribution)
+      {
+      case Distribution::kUniform:
+        positions.push_back({ coord(rng_), coord(rng_) });
+        break;
+      case Distribution::kClustered:
+      {
+        const Vec2& c = centers[rng_() % centers.size()];
+        positions.push_back({ c.x + spread(rng_), c.y + spread(rng_) });
+        break;
+      }
+      case Distribution::kCollinear:
+      {
+        float x = coord(rng_);
+        positions.push_back({ x, 0.3f * x + jitter(rng_) });
+        break;
+      }
+      case Distribution::kCircle:
+      {
+        double a = turn(rng_);
+        positions.push_back({ (float)(1000.0 * cos(a)), (float)(1000.0 * sin(a)) });
+        break;
+      }
+      }
+    }
+
+    sim.AddPoints(positions);
+
+    Reset(sim, WindmillSim::Engine::kFrameStepped);
+  }
+
+  StageResult CheckPointSide(WindmillSim& sim)
+  {
+    size_t n = sim.points_.size();
+    volatile size_t sink = 0;
+
+    double per_pass = TimePerCall(BatchFor(n), [&]()
+                                  {
+                                    size_t on_clockwise = 0;
+                                    for (size_t i = 0; i < n; i++)
+                                      on_clockwise += sim.CheckPointSide(i);
+                                    sink = sink + on_clockwise;
+                                  });
+
+    return { per_pass * 1e9 / n, per_pass * 1e9 / n, -1.0 };
+  }
+
+  StageResult UpdatePoints(WindmillSim& sim)
+  {
+    size_t n = sim.points_.size();
+    double rad = sim.current_rad_;
+    double step = getFrameRad(sim);
+    bool odd = false;
+
+    double per_call = TimePerCall(BatchFor(n), [&]()
+                                  {
+                                    odd = !odd;
+                                    sim.UpdatePoints(odd ? rad + step : rad);
+                                  });
+
+    return { per_call * 1e9 / n, per_call * 1e9, -1.0 };
+  }
+
+  // Same as the frame stepped engine, but only the switch search is timed
+  StageResult CheckPointSwitches(WindmillSim& sim)
+  {
+    Reset(sim, WindmillSim::Engine::kFrameStepped);
+
+    size_t n = sim.points_.size();
+    double sweep = getFrameRad(sim);
+    size_t calls = 0, switch_count = 0;
+    double timed = 0.0;
+
+    auto begin = Clock::now();
+    do
+    {
+      sim.UpdatePoints(sim.current_rad_ + sweep);
+
+      double swept;
+      auto start = Clock::now();
+      bool switched = sim.CheckPointSwitches(sweep, swept);
+      timed += Seconds(start, Clock::now());
+      calls++;
+
+      if (switched)
+      {
+        switch_count++;
+        sim.UpdatePoints(sim.current_rad_);
+      }
+      else
+        sim.AdvanceLine(sweep - swept);
+    } while (Seconds(begin, Clock::now()) < budget_);
+
+    return { timed * 1e9 / calls / n, timed * 1e9 / calls, switch_count / timed };
+  }
+
+  // Switches to random points, path bookkeeping included
+  StageResult SwitchPivot(WindmillSim& sim)
+  {
+    Reset(sim, WindmillSim::Engine::kFrameStepped);
+
+    size_t n = sim.points_.size();
+    if (n < 2)
+      return { 0.0, 0.0, -1.0 };
+
+    std::vector<size_t> targets(4096);
+    for (auto& slot : targets)
+      slot = rng_() % n;
+
+    size_t calls = 0, switch_count = 0;
+    double elapsed = 0.0;
+
+    auto begin = Clock::now();
+    do
+    {
+      for (size_t i = 0; i < 64; i++, calls++)
+        switch_count += sim.SwitchPivot(targets[calls % targets.size()]);
+      elapsed = Seconds(begin, Clock::now());
+    } while (elapsed < budget_);
+
+    Reset(sim, WindmillSim::Engine::kFrameStepped);
+
+    return { elapsed * 1e9 / calls / n, elapsed * 1e9 / calls, switch_count / elapsed };
+  }
+
+  // Whole frames through the public Update, each crossing a few points
+  StageResult UpdateLoop(WindmillSim& sim, WindmillSim::Engine engine)
+  {
+    Reset(sim, engine);
+
+    size_t n = sim.points_.size();
+    double dt = getFrameRad(sim) / sim.rads_per_second_;
+    size_t frames = 0, switch_count = 0;
+    double elapsed = 0.0;
+
+    auto begin = Clock::now();
+    do
+    {
+      sim.Update(dt);
+      switch_count += sim.getSwitches().size();
+      frames++;
+      elapsed = Seconds(begin, Clock::now());
+    } while (elapsed < budget_);
+
+    return { elapsed * 1e9 / frames / n, elapsed * 1e9 / frames, switch_count / elapsed };
+  }
+
+};
+
+const double SimBenchmark::crossings_per_frame_ = 4.0;
+
+
+static void PrintRow(const char* stage, const StageResult& r)
+{
+  printf("  %-22s %12.3f %14.1f", stage, r.ns_per_point, r.ns_per_call);
+  if (r.switches_per_sec >= 0.0)
+    printf(" %14.0f\n", r.switches_per_sec);
+  else
+    printf(" %14s\n", "-");
+}
+
+
+static double getPeakMemoryMiB()
+{
+#if defined(__unix__)
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0; // kilobytes on Linux
+#else
+  return 0.0;
+#endif
+}
+
+
+static void PrintUsage()
+{
+  printf("Usage: windmill_bench [options]\n"
+         "  --sizes A,B,...   point counts (default 10,100,...,10000000)\n"
+         "  --max N           skip point counts above N\n"
+         "  --dist NAME       uniform, clustered, collinear or circle (default all)\n"
+         "  --budget SEC      time spent on each stage (default 0.2)\n"
+         "  --seed S          seed for the point sets (default 1)\n");
+}
+
+
+int main(int argc, char** argv)
+{
+  std::vector<size_t> sizes = { 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+  size_t max_size = (size_t)-1;
+  std::vector<Distribution> distributions = { Distribution::kUniform, Distribution::kClustered,
+                                              Distribution::kCollinear, Distribution::kCircle };
+  double budget = 0.2;
+  unsigned seed = 1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    bool has_value = i + 1 < argc;
+
+    if (!strcmp(argv[i], "--sizes") && has_value)
+    {
+      sizes.clear();
+      for (char* s = argv[++i]; *s; )
+      {
+        sizes.push_back(strtoull(s, &s, 10));
+        if (*s == ',')
+          s++;
+        else if (*s)
+          break;
+      }
+    }
+    else if (!strcmp(argv[i], "--max") && has_value)
+      max_size = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--budget") && has_value)
+      budget = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && has_value)
+      seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--dist") && has_value)
+    {
+      const char* name = argv[++i];
+      distributions.clear();
+      for (int d = 0; d < 4; d++)
+      {
+        if (!strcmp(name, distribution_names[d]))
+          distributions.push_back((Distribution)d);
+      }
+      if (distributions.empty())
+      {
+        PrintUsage();
+        return 1;
+      }
+    }
+    else
+    {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  SimBenchmark bench(budget, seed);
+
+  for (Distribution distribution : distributions)
+  {
+    for (size_t n : sizes)
+    {
+      if (n < 2 || n > max_size)
+        continue;
+
+      WindmillSim sim;
+      bench.Fill(sim, distribution, n);
+
+      printf("%s, %zu points\n", distribution_names[(int)distribution], n);
+      printf("  %-22s %12s %14s %14s\n", "stage", "ns/point", "ns/call", "switches/sec");
+
+      PrintRow("CheckPointSide", bench.CheckPointSide(sim));
+      PrintRow("UpdatePoints", bench.UpdatePoints(sim));
+      PrintRow("CheckPointSwitches", bench.CheckPointSwitches(sim));
+      PrintRow("SwitchPivot", bench.SwitchPivot(sim));
+      PrintRow("Update (frame)", bench.UpdateLoop(sim, WindmillSim::Engine::kFrameStepped));
+      PrintRow("Update (event)", bench.UpdateLoop(sim, WindmillSim::Engine::kEventDriven));
+
+      printf("  memory: %.1f MiB simulation, %.1f MiB peak\n\n",
+             sim.getMemoryUsed() / (1024.0 * 1024.0), getPeakMemoryMiB());
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,211 @@
+// Command line runner for the windmill simulation. Loads a point set, runs
+// the windmill for a number of revolutions as fast as it can and reports the
+// switch rate and the sequence of pivots.
+//
+//   windmill_run [options] [points.txt]
+//
+// The point file holds one "x y" pair per line.
+
+#define _USE_MATH_DEFINES
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "../Sim/Trace.h"
+#include "../Sim/WindmillSim.h"
+
+
+static void PrintUsage()
+{
+  printf("Usage: windmill_run [options] [points.txt]\n"
+         "  --random N        use N uniformly random points instead of a file\n"
+         "  --seed S          seed for --random (default 1)\n"
+         "  --revolutions R   revolutions to run (default 10)\n"
+         "  --engine E        'event' or 'frame' (default event)\n"
+         "  --step RAD        radians advanced per update (default 0.05)\n"
+         "  --pivot SLOT      starting pivot (default 0)\n"
+         "  --precompute      build the transition table before running\n"
+         "  --print N         pivots of the sequence to print (default 100, -1 for all)\n"
+         "  --trace FILE      write a Chrome trace of the run to FILE\n");
+}
+
+
+static bool LoadPoints(const char* path, WindmillSim& sim)
+{
+  FILE* file = fopen(path, "r");
+  if (!file)
+  {
+    fprintf(stderr, "could not open %s\n", path);
+    return false;
+  }
+
+  std::vector<Vec2> positions;
+
+  float x, y;
+  while (fscanf(file, "%f %f", &x, &y) == 2)
+    positions.push_back({ x, y });
+
+  fclose(file);
+
+  sim.AddPoints(positions);
+  return true;
+}
+
+
+static void AddRandomPoints(size_t count, unsigned seed, WindmillSim& sim)
+{
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> coord(-1000.0f, 1000.0f);
+
+  std::vector<Vec2> positions(count);
+  for (size_t i = 0; i < count; i++)
+    positions[i] = { coord(rng), coord(rng) };
+
+  sim.AddPoints(positions);
+}
+
+
+int main(int argc, char** argv)
+{
+  const char* path = nullptr;
+  const char* trace_path = nullptr;
+  size_t random_count = 0;
+  unsigned seed = 1;
+  double revolutions = 10.0;
+  double step = 0.05;
+  size_t pivot = 0;
+  bool precompute = false;
+  long print_limit = 100;
+  WindmillSim::Engine engine = WindmillSim::Engine::kEventDriven;
+
+  for (int i = 1; i < argc; i++)
+  {
+    bool has_value = i + 1 < argc;
+
+    if (!strcmp(argv[i], "--random") && has_value)
+      random_count = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--seed") && has_value)
+      seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--revolutions") && has_value)
+      revolutions = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--step") && has_value)
+      step = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--pivot") && has_value)
+      pivot = strtoull(argv[++i], nullptr, 10);
+    else if (!strcmp(argv[i], "--print") && has_value)
+      print_limit = atol(argv[++i]);
+    else if (!strcmp(argv[i], "--trace") && has_value)
+      trace_path = argv[++i];
+    else if (!strcmp(argv[i], "--precompute"))
+      precompute = true;
+    else if (!strcmp(argv[i], "--engine") && has_value)
+    {
+      const char* name = argv[++i];
+      if (!strcmp(name, "frame"))
+        engine = WindmillSim::Engine::kFrameStepped;
+      else if (!strcmp(name, "event"))
+        engine = WindmillSim::Engine::kEventDriven;
+      else
+      {
+        PrintUsage();
+        return 1;
+      }
+    }
+    else if (argv[i][0] != '-' && !path)
+      path = argv[i];
+    else
+    {
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  if ((!path && random_count == 0) || step <= 0.0)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  if (trace_path)
+    Trace::setEnabled(true);
+
+  WindmillSim sim;
+  sim.setEngine(engine);
+
+  if (path)
+  {
+    if (!LoadPoints(path, sim))
+      return 1;
+  }
+  else
+    AddRandomPoints(random_count, seed, sim);
+
+  const PointStore& points = sim.getPoints();
+  if (pivot >= points.size())
+  {
+    fprintf(stderr, "pivot %zu out of range, %zu points loaded\n", pivot, points.size());
+    return 1;
+  }
+
+  sim.ChoosePivot(pivot);
+  sim.Start();
+
+  if (precompute && !sim.PrecomputeTransitions())
+    fprintf(stderr, "transition table does not fit in memory, running without it\n");
+
+  std::vector<PointId> sequence;
+  sequence.push_back(points.id(pivot));
+
+  size_t switch_count = 0;
+  double target = revolutions * 2 * M_PI;
+  double swept = 0.0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  while (swept < target)
+  {
+    double rad = std::min(step, target - swept);
+    sim.Advance(rad);
+    swept += rad;
+
+    switch_count += sim.getSwitches().size();
+
+    for (unsigned slot : sim.getSwitches())
+    {
+      if (print_limit < 0 || (long)sequence.size() < print_limit)
+        sequence.push_back(points.id(slot));
+    }
+  }
+
+  auto end = std::chrono::steady_clock::now();
+  double seconds = std::chrono::duration<double>(end - start).count();
+
+  printf("points:       %zu\n", points.size());
+  printf("engine:       %s\n", engine == WindmillSim::Engine::kEventDriven ? "event" : "frame");
+  printf("revolutions:  %g\n", revolutions);
+  printf("switches:     %zu\n", switch_count);
+  printf("elapsed:      %.6f s\n", seconds);
+  printf("switches/sec: %.0f\n", seconds > 0.0 ? switch_count / seconds : 0.0);
+
+  printf("sequence:    ");
+  for (PointId id : sequence)
+    printf(" %llu", (unsigned long long)id);
+  if (print_limit >= 0 && switch_count + 1 > sequence.size())
+    printf(" ...");
+  printf("\n");
+
+  if (trace_path && !Trace::WriteJson(trace_path))
+  {
+    fprintf(stderr, "could not write %s\n", trace_path);
+    return 1;
+  }
+
+  return 0;
+}